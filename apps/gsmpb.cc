@@ -31,6 +31,9 @@
 #include <gsmlib/gsm_util.h>
 #include <gsmlib/gsm_sorted_phonebook.h>
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include <map>
 
 #ifdef HAVE_GETOPT_LONG
 static struct option longOpts[] =
@@ -57,182 +60,172 @@ static struct option longOpts[] =
   getopt(argc, argv, options)
 #endif
 
-// insert those entries from sourcePhonebook into destPhonebook
-// that are not already present in destPhonebook
+// synchronize destPhonebook with sourcePhonebook
+// the differences are computed first and then applied in slot order, so
+// that unchanged entries are not written at all (each write to the ME
+// takes time):
+// - entries with the same contents (text, telephone number, and index if
+//   indexed) in both phonebooks are left alone
+// - destination entries not present in the source are overwritten with
+//   missing source entries, preferably with the one that has the same
+//   text (or index if indexed); this takes one write instead of a delete
+//   and an insert
+// - remaining destination entries are deleted, remaining source entries
+//   are inserted
 
-void insertNotPresent(gsmlib::SortedPhonebookRef sourcePhonebook,
-                      gsmlib::SortedPhonebookRef destPhonebook,
-                      bool indexed, bool verbose)
+typedef gsmlib::SortedPhonebookBase::iterator PhonebookIterator;
+typedef std::pair<int, std::pair<std::string, std::string> > EntryKey;
+typedef std::pair<int, std::string> SlotKey;
+
+// return contents of entry (the index only if indexed)
+
+EntryKey entryKey(PhonebookIterator i, bool indexed)
 {
-  for (gsmlib::SortedPhonebookBase::iterator i = sourcePhonebook->begin();
-       i != sourcePhonebook->end(); ++i)
-  {
-    std::pair<gsmlib::SortedPhonebookBase::iterator, gsmlib::SortedPhonebookBase::iterator> range;
-    if (indexed)
-    {
-      int index = i->index();
-      range = destPhonebook->equal_range(index);
-    }
-    else
-    {
-      std::string text = i->text();
-      range = destPhonebook->equal_range(text);
-    }
+  return EntryKey(indexed ? i->index() : -1,
+                  std::make_pair(i->text(), i->telephone()));
+}
 
-    // do nothing if the entry is already present in the destination
-    bool alreadyPresent = false;
-    for (gsmlib::SortedPhonebookBase::iterator j = range.first;
-         j != range.second; ++j)
-    {
-      i->setUseIndex(indexed);
-      if (i->telephone() == j->telephone())
-      {
-        alreadyPresent = true;
-        break;
-      }
-    }
-    // ... else insert it
-    if (!alreadyPresent)
-    {
-      if (verbose)
-      {
-	std::cout << gsmlib::stringPrintf(_("inserting '%s' tel# %s"),
-                             i->text().c_str(), i->telephone().c_str());
-        if (indexed)
-	  std::cout << gsmlib::stringPrintf(_(" (index #%d)"), i->index());
-	std::cout << std::endl;
-      }
-      i->setUseIndex(indexed);
-      destPhonebook->insert(*i); // insert
-    }
-  }
+// return key used to select destination entries to overwrite
+
+SlotKey slotKey(PhonebookIterator i, bool indexed)
+{
+  return indexed ? SlotKey(i->index(), "") : SlotKey(-1, i->text());
 }
 
-// update those entries in destPhonebook, that
-// - have the same name as one entry in destPhonebook
-// - but have a different telephone number
-// this is only done if the name in question is unique in the destPhonebook
-// the case of several entries having the same in the sourcePhonebook
-// is handled - only the first is considered for updating
+// change to a destination entry, source == dest means delete
 
-void updateEntries(gsmlib::SortedPhonebookRef sourcePhonebook,
-                   gsmlib::SortedPhonebookRef destPhonebook,
-                   bool verbose)
+struct Change
 {
-  bool firstLoop = true;
-  std::string lastText;
+  PhonebookIterator _dest, _source;
+  bool _delete;
 
-  for (gsmlib::SortedPhonebookBase::iterator i = sourcePhonebook->begin();
-       i != sourcePhonebook->end(); ++i)
-  {
-    std::string text = i->text();
-    if (!firstLoop && text != lastText)
+  Change(PhonebookIterator dest, PhonebookIterator source, bool del) :
+    _dest(dest), _source(source), _delete(del) {}
+
+  bool operator<(const Change &c) const
     {
-      std::pair<gsmlib::SortedPhonebookBase::iterator,
-		 gsmlib::SortedPhonebookBase::iterator> range =
-        destPhonebook->equal_range(text);
-      
-      gsmlib::SortedPhonebookBase::iterator first = range.first;
-      if (first != destPhonebook->end() && range.second == ++first)
-      {                         // just one text in the destPhonebook
-        if (!(*range.first == *i)) // overwrite if different in destination
-        {
-          if (verbose)
-	    std::cout << gsmlib::stringPrintf(_("updating '%s' tel# %s to new tel# %s"),
-					      range.first->text().c_str(),
-					      range.first->telephone().c_str(),
-					      i->telephone().c_str())
-		      << std::endl;
-          
-          *range.first = *i;
-        }
-      }
-      lastText = text;
+      PhonebookIterator d = _dest, e = c._dest;
+      return d->index() < e->index();
     }
-    firstLoop = false;
-  }
-}
-
-// the same but for indexed phonebooks
+};
 
-void updateEntriesIndexed(gsmlib::SortedPhonebookRef sourcePhonebook,
-                          gsmlib::SortedPhonebookRef destPhonebook,
-                          bool verbose)
+void synchronize(gsmlib::SortedPhonebookRef sourcePhonebook,
+                 gsmlib::SortedPhonebookRef destPhonebook,
+                 bool indexed, bool verbose)
 {
-  for (gsmlib::SortedPhonebookBase::iterator i = sourcePhonebook->begin();
+  // source entries by contents
+  std::map<EntryKey, std::vector<PhonebookIterator> > sourceEntries;
+  for (PhonebookIterator i = sourcePhonebook->begin();
        i != sourcePhonebook->end(); ++i)
+    sourceEntries[entryKey(i, indexed)].push_back(i);
+
+  // find destination entries that are not present in the source
+  std::multimap<SlotKey, PhonebookIterator> stale;
+  for (PhonebookIterator j = destPhonebook->begin();
+       j != destPhonebook->end(); ++j)
   {
-    int index = i->index();
-    
-    gsmlib::SortedPhonebookBase::iterator j = destPhonebook->find(index);
-    
-    if (j != destPhonebook->end())
-    {                           // index present in the destPhonebook
-      if (! (*j == *i))         // overwrite if different in destination
-      {
-        if (verbose)
-	  std::cout << gsmlib::stringPrintf(_("updating '%s' tel# %s to new tel# %s"
-					      "(index %d)"),
-					    j->text().c_str(),
-					    j->telephone().c_str(),
-					    i->telephone().c_str(), i->index())
-		    << std::endl;
-        *j = *i;
-      }
-    }
+    std::map<EntryKey, std::vector<PhonebookIterator> >::iterator k =
+      sourceEntries.find(entryKey(j, indexed));
+    if (k != sourceEntries.end() && k->second.size() > 0)
+      k->second.pop_back();     // unchanged
+    else
+      stale.insert(std::make_pair(slotKey(j, indexed), j));
   }
-}
-
-// delete those entries from destPhonebook, that are not present
-// in sourcePhonebook
 
-void deleteNotPresent(gsmlib::SortedPhonebookRef sourcePhonebook,
-                      gsmlib::SortedPhonebookRef destPhonebook,
-                      bool indexed, bool verbose)
-{
-  for (gsmlib::SortedPhonebookBase::iterator i = destPhonebook->begin();
-       i != destPhonebook->end(); ++i)
-  {
-    std::pair<gsmlib::SortedPhonebookBase::iterator, gsmlib::SortedPhonebookBase::iterator> range;
-    if (indexed)
+  // overwrite stale entries with the same text or index
+  std::vector<Change> changes;
+  std::vector<PhonebookIterator> missing;
+  for (std::map<EntryKey, std::vector<PhonebookIterator> >::iterator k =
+         sourceEntries.begin(); k != sourceEntries.end(); ++k)
+    for (std::vector<PhonebookIterator>::iterator i = k->second.begin();
+         i != k->second.end(); ++i)
     {
-      int index = i->index();
-      range = sourcePhonebook->equal_range(index);
+      std::multimap<SlotKey, PhonebookIterator>::iterator j =
+        stale.find(slotKey(*i, indexed));
+      if (j != stale.end())
+      {
+        changes.push_back(Change(j->second, *i, false));
+        stale.erase(j);
+      }
+      else
+        missing.push_back(*i);
     }
-    else
+
+  // reuse the remaining stale entries (the index of entries in indexed
+  // phonebooks is fixed)
+  std::vector<PhonebookIterator>::iterator nextMissing = missing.begin();
+  if (! indexed)
+    for (; nextMissing != missing.end() && stale.size() > 0; ++nextMissing)
     {
-      std::string text = i->text();
-      range = sourcePhonebook->equal_range(text);
+      changes.push_back(Change(stale.begin()->second, *nextMissing, false));
+      stale.erase(stale.begin());
     }
-        
-    bool found = false;
-    for (gsmlib::SortedPhonebookBase::iterator j = range.first;
-         j != range.second; ++j)
+  for (std::multimap<SlotKey, PhonebookIterator>::iterator j = stale.begin();
+       j != stale.end(); ++j)
+    changes.push_back(Change(j->second, j->second, true));
+
+  // apply changes in slot order
+  std::sort(changes.begin(), changes.end());
+  for (std::vector<Change>::iterator c = changes.begin();
+       c != changes.end(); ++c)
+  {
+    PhonebookIterator i = c->_source, j = c->_dest;
+    if (c->_delete)
     {
-      i->setUseIndex(indexed);
-      if (j->telephone() == i->telephone())
+      if (verbose)
       {
-        found = true;
-        break;
+	std::cout << gsmlib::stringPrintf(_("deleting '%s' tel# %s"),
+                             j->text().c_str(), j->telephone().c_str());
+        if (indexed)
+	  std::cout << gsmlib::stringPrintf(_(" (index #%d)"), j->index());
+	std::cout << std::endl;
       }
+      destPhonebook->erase(j);
     }
-    if (!found)
+    else
     {
       if (verbose)
       {
-	std::cout << gsmlib::stringPrintf(_("deleting '%s' tel# %s"),
-                             i->text().c_str(), i->telephone().c_str());
         if (indexed)
-	  std::cout << gsmlib::stringPrintf(_(" (index #%d)"), i->index());
+	  std::cout << gsmlib::stringPrintf(_("updating '%s' tel# %s to new tel# %s"
+					      "(index %d)"),
+					    j->text().c_str(),
+					    j->telephone().c_str(),
+					    i->telephone().c_str(), i->index());
+        else if (j->text() == i->text())
+	  std::cout << gsmlib::stringPrintf(_("updating '%s' tel# %s to new tel# %s"),
+					    j->text().c_str(),
+					    j->telephone().c_str(),
+					    i->telephone().c_str());
+        else
+	  std::cout << gsmlib::stringPrintf(_("replacing '%s' tel# %s with "
+					      "'%s' tel# %s"),
+					    j->text().c_str(),
+					    j->telephone().c_str(),
+					    i->text().c_str(),
+					    i->telephone().c_str());
 	std::cout << std::endl;
       }
-      destPhonebook->erase(i);
-#ifdef BUGGY_MAP_ERASE
-	  deleteNotPresent(sourcePhonebook, destPhonebook, indexed, verbose);
-	  return;
-#endif
+      destPhonebook->replace(j, *i);
     }
   }
+
+  // insert the remaining source entries
+  for (; nextMissing != missing.end(); ++nextMissing)
+  {
+    PhonebookIterator i = *nextMissing;
+    if (verbose)
+    {
+      std::cout << gsmlib::stringPrintf(_("inserting '%s' tel# %s"),
+                                        i->text().c_str(),
+                                        i->telephone().c_str());
+      if (indexed)
+        std::cout << gsmlib::stringPrintf(_(" (index #%d)"), i->index());
+      std::cout << std::endl;
+    }
+    i->setUseIndex(indexed);
+    destPhonebook->insert(*i);
+  }
 }
 
 // *** main program
@@ -452,29 +445,10 @@ int main(int argc, char *argv[])
     // now do the actual work
     if (doSynchronize)
     {                           // synchronizing
-      if (indexed)
-      {
-        sourcePhonebook->setSortOrder(gsmlib::ByIndex);
-        destPhonebook->setSortOrder(gsmlib::ByIndex);
-        // for an explanation see below
-        updateEntriesIndexed(sourcePhonebook, destPhonebook, verbose);
-        deleteNotPresent(sourcePhonebook, destPhonebook, true, verbose);
-        insertNotPresent(sourcePhonebook, destPhonebook, true, verbose);
-      }
-      else
-      {
-        sourcePhonebook->setSortOrder(gsmlib::ByText);
-        destPhonebook->setSortOrder(gsmlib::ByText);
-        // the following is done to avoid superfluous writes to the TA
-        // (that takes time) and keep updated (ie. telephone number changed)
-        // entries at the same place
-        // 1. update entries in place where just the number changed
-        updateEntries(sourcePhonebook, destPhonebook, verbose);
-        // 2. delete those that are not present anymore
-        deleteNotPresent(sourcePhonebook, destPhonebook, false, verbose);
-        // 3. insert the new ones
-        insertNotPresent(sourcePhonebook, destPhonebook, false, verbose);
-      }
+      gsmlib::SortOrder sortOrder = indexed ? gsmlib::ByIndex : gsmlib::ByText;
+      sourcePhonebook->setSortOrder(sortOrder);
+      destPhonebook->setSortOrder(sortOrder);
+      synchronize(sourcePhonebook, destPhonebook, indexed, verbose);
     }
     else
     {                           // copying
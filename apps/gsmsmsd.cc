@@ -654,7 +654,6 @@ int main(int argc, char *argv[])
         else
         {
 	  gsmlib::SMSStoreRef store = me->getSMSStore(storeName);
-          store->setCaching(false);
 
           if (messageType == gsmlib::GsmEvent::CellBroadcastSMS)
             result += (*store.getptr())[index].cbMessage()->toString();
@@ -32,6 +32,7 @@
 #include <gsmlib/gsm_util.h>
 #include <gsmlib/gsm_sorted_sms_store.h>
 #include <iostream>
+#include <set>
 
 #ifdef HAVE_GETOPT_LONG
 static struct option longOpts[] =
@@ -49,6 +50,8 @@ static struct option longOpts[] =
   {"copy", no_argument, (int*)NULL, 'c'},
   {"delete", no_argument, (int*)NULL, 'x'},
   {"backup", no_argument, (int*)NULL, 'k'},
+  {"stream", no_argument, (int*)NULL, 'S'},
+  {"since-last", no_argument, (int*)NULL, 'n'},
   {"help", no_argument, (int*)NULL, 'h'},
   {"version", no_argument, (int*)NULL, 'v'},
   {"verbose", no_argument, (int*)NULL, 'V'},
@@ -91,6 +94,19 @@ void backup(gsmlib::SortedSMSStoreRef destStore, gsmlib::SMSStoreEntry &entry)
   destStore->insert(entry);     // insert
 }
 
+// aux function, return true if no indices are given or if index is
+// among the indices
+
+bool selected(int index, int optind, int argc, char *argv[])
+{
+  if (optind == argc)
+    return true;
+  for (int i = optind; i < argc; ++i)
+    if (atoi(argv[i]) == index)
+      return true;
+  return false;
+}
+
 // aux function, throw exception if operation != NoOp
 
 void checkNoOp(Operation operation, int opt)
@@ -114,6 +130,10 @@ int main(int argc, char *argv[])
     std::string storeName;
     char operation = NoOp;
     gsmlib::SortedSMSStoreRef sourceStore, destStore;
+    gsmlib::SMSStoreReaderRef sourceReader;
+    bool stream = false;        // read source file message by message
+    bool sinceLast = false;     // only back up unread messages of source
+    gsmlib::SMSStoreRef sourceSMSStore;
     bool useIndices = false;    // use indices in delete, copy, backup op
     std::string initString = gsmlib::DEFAULT_INIT_STRING;
     bool swHandshake = false;
@@ -123,7 +143,7 @@ int main(int argc, char *argv[])
 
     int opt;
     int dummy;
-    while((opt = getopt_long(argc, argv, "I:t:s:d:b:cxlakhvVXC:",
+    while((opt = getopt_long(argc, argv, "I:t:s:d:b:cxlakhvVXC:Sn",
                              longOpts, &dummy))
           != -1)
       switch (opt)
@@ -134,6 +154,12 @@ int main(int argc, char *argv[])
       case 'X':
         swHandshake = true;
         break;
+      case 'S':
+        stream = true;
+        break;
+      case 'n':
+        sinceLast = true;
+        break;
       case 'I':
         initString = optarg;
         break;
@@ -180,8 +206,8 @@ int main(int argc, char *argv[])
       case 'h':
 	std::cerr << argv[0] << _(": [-a][-b baudrate][-c][-C sca]"
 				  "[-d device or file]\n"
-				  "  [-h][-I init string][-k][-l]"
-				  "[-s device or file]"
+				  "  [-h][-I init string][-k][-l][-n]"
+				  "[-s device or file][-S]"
 				  "[-t SMS store name]\n  [-v][-V][-x][-X]"
 				  "{indices}|[phonenumber text]") << std::endl
 		  << std::endl
@@ -204,8 +230,13 @@ int main(int argc, char *argv[])
 		       "                    (if indices are given, "
 		       "copy only these entries)") << std::endl
 		  << _("  -l, --list        list source to stdout") << std::endl
+		  << _("  -n, --since-last  backup only messages that are new\n"
+		       "                    since the last run (device source)")
+		  << std::endl
 		  << _("  -s, --source      sets the source device to connect to,\n"
 		       "                    or the file to read") << std::endl
+		  << _("  -S, --stream      read source file message by message\n"
+		       "                    in file order") << std::endl
 		  << _("  -t, --store       name of SMS store to use") << std::endl
 		  << _("  -v, --version     prints version and exits") << std::endl
 		  << _("  -V, --verbose     print detailed progress messages")
@@ -237,11 +268,17 @@ int main(int argc, char *argv[])
     }
     if (operation == AddOp || operation == DeleteOp)
     {
+      if (stream)
+        throw gsmlib::GsmException(_("option '--stream' requires a source"),
+                                   gsmlib::ParameterError);
       if (source.length() != 0)
         throw gsmlib::GsmException(_("source must not be given"), gsmlib::ParameterError);
       if (destination.length() == 0)
         throw gsmlib::GsmException(_("destination required"), gsmlib::ParameterError);
     }
+    if (sinceLast && (operation != BackupOp || stream))
+      throw gsmlib::GsmException(_("option '--since-last' requires "
+                                   "'--backup'"), gsmlib::ParameterError);
     if (operation == CopyOp || operation == DeleteOp || operation == BackupOp)
     {
       // check if all indices are numbers
@@ -251,6 +288,10 @@ int main(int argc, char *argv[])
             throw gsmlib::GsmException(gsmlib::stringPrintf(_("expected number, got '%s'"),
                                             argv[i]), gsmlib::ParameterError);
       useIndices = optind != argc;
+      if (useIndices && sinceLast)
+        throw gsmlib::GsmException(_("indices must not be given with "
+                                     "'--since-last'"),
+                                   gsmlib::ParameterError);
     }
     else if (operation == AddOp)
     {
@@ -268,7 +309,22 @@ int main(int argc, char *argv[])
     // start accessing source store or file if required by operation
     if (operation == CopyOp || operation == BackupOp || operation == ListOp)
       {
-	if (source == "-")
+	if (stream)
+	  {
+	    if (source == "-")
+	      sourceReader = new gsmlib::SMSStoreReader();
+	    else if (gsmlib::isFile(source))
+	      sourceReader = new gsmlib::SMSStoreReader(source);
+	    else
+	      throw gsmlib::GsmException(_("option '--stream' requires a "
+					   "source file"),
+					 gsmlib::ParameterError);
+	  }
+	else if (sinceLast && (source == "-" || gsmlib::isFile(source)))
+	  throw gsmlib::GsmException(_("option '--since-last' requires "
+				       "a source device"),
+				     gsmlib::ParameterError);
+	else if (source == "-")
 	  sourceStore = new gsmlib::SortedSMSStore(true);
 	else if (gsmlib::isFile(source))
 	  sourceStore = new gsmlib::SortedSMSStore(source);
@@ -287,7 +343,11 @@ int main(int argc, char *argv[])
 					   baudrate == "" ? gsmlib::DEFAULT_BAUD_RATE :
 					   gsmlib::baudRateStrToSpeed(baudrate), initString,
 					   swHandshake));
-	    sourceStore = new gsmlib::SortedSMSStore(sourceMeTa->getSMSStore(storeName));
+	    if (sinceLast)
+	      // only the unread messages are read, see below
+	      sourceSMSStore = sourceMeTa->getSMSStore(storeName);
+	    else
+	      sourceStore = new gsmlib::SortedSMSStore(sourceMeTa->getSMSStore(storeName));
 	  }
       }
       
@@ -326,6 +386,52 @@ int main(int argc, char *argv[])
       }
 
     // now do the actual work
+    if (stream)
+    {
+      // entries are handled one by one in file order, indices only
+      // select entries
+      if (operation == CopyOp)
+        destStore->clear();
+      gsmlib::SMSStoreEntryRef entry;
+      std::set<int> found;
+      while (sourceReader->next(entry))
+      {
+        if (! selected(entry->index(), optind, argc, argv))
+          continue;
+        found.insert(entry->index());
+        switch (operation)
+        {
+        case BackupOp:
+          backup(destStore, entry());
+          break;
+        case CopyOp:
+          if (verbose)
+            std::cout << gsmlib::stringPrintf(_("inserting entry #%d from source "
+                                   "into destination"), entry->index())
+                      << std::endl << entry->message()->toString();
+          destStore->insert(entry());
+          break;
+        case ListOp:
+          std::cout << gsmlib::stringPrintf(_("index #%d"), entry->index())
+                    << std::endl << entry->message()->toString();
+          break;
+        }
+      }
+      for (int i = optind; i < argc; ++i)
+        if (found.find(atoi(argv[i])) == found.end())
+          throw gsmlib::GsmException(gsmlib::stringPrintf(_("no index '%s' in source"),
+                                          argv[i]), gsmlib::ParameterError);
+    }
+    else if (sinceLast)
+    {
+      // messages that arrived since the last run are still unread
+      std::vector<gsmlib::SMSStore::iterator> newEntries;
+      sourceSMSStore->syncUnread(newEntries);
+      for (std::vector<gsmlib::SMSStore::iterator>::iterator i =
+             newEntries.begin(); i != newEntries.end(); ++i)
+        backup(destStore, **i);
+    }
+    else
     switch (operation)
     {
     case BackupOp:
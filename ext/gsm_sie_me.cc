@@ -74,7 +74,7 @@ IntRange SieMe:: getSupportedSignalTones() throw(GsmException)
   // ^SPST: (0-4),(0,1)
   IntRange typeRange = p.parseRange();
   p.parseComma();
-  std::vector<bool> volumeList = p.parseIntList();
+  p.parseIntSet();             // volumes
   return typeRange;
 }
 
@@ -27,23 +27,23 @@ using namespace gsmlib;
 
 // GsmAt members
 
-bool GsmAt::matchResponse(std::string answer, std::string responseToMatch)
+bool GsmAt::matchResponse(StringView answer, StringView responseToMatch)
 {
-  if (answer.substr(0, responseToMatch.length()) == responseToMatch)
+  if (answer.startsWith(responseToMatch))
     return true;
   else
     // some TAs omit the ':' at the end of the response
     if (_meTa.getCapabilities()._omitsColon &&
         responseToMatch[responseToMatch.length() - 1] == ':' &&
-        answer.substr(0, responseToMatch.length() - 1) == 
-        responseToMatch.substr(0, responseToMatch.length() - 1))
+        answer.startsWith(responseToMatch.substr(
+                            0, responseToMatch.length() - 1)))
       return true;
   return false;
 }
 
-std::string GsmAt::cutResponse(std::string answer, std::string responseToMatch)
+StringView GsmAt::cutResponse(StringView answer, StringView responseToMatch)
 {
-  if (answer.substr(0, responseToMatch.length()) == responseToMatch)
+  if (answer.startsWith(responseToMatch))
     return normalize(answer.substr(responseToMatch.length(),
                                    answer.length() -
                                    responseToMatch.length()));
@@ -51,13 +51,13 @@ std::string GsmAt::cutResponse(std::string answer, std::string responseToMatch)
     // some TAs omit the ':' at the end of the response
     if (_meTa.getCapabilities()._omitsColon &&
         responseToMatch[responseToMatch.length() - 1] == ':' &&
-        answer.substr(0, responseToMatch.length() - 1) == 
-        responseToMatch.substr(0, responseToMatch.length() - 1))
+        answer.startsWith(responseToMatch.substr(
+                            0, responseToMatch.length() - 1)))
       return normalize(answer.substr(responseToMatch.length() - 1,
                                      answer.length() -
                                      responseToMatch.length() + 1));
   assert(0);
-  return "";
+  return StringView();
 }
 
 void GsmAt::throwCmeException(std::string s) throw(GsmException)
@@ -67,9 +67,9 @@ void GsmAt::throwCmeException(std::string s) throw(GsmException)
 
   bool meError = matchResponse(s, "+CME ERROR:");
   if (meError)
-    s = cutResponse(s, "+CME ERROR:");
+    s = cutResponse(s, "+CME ERROR:").str();
   else
-    s = cutResponse(s, "+CMS ERROR:");
+    s = cutResponse(s, "+CMS ERROR:").str();
   std::istringstream is(s.c_str());
   int error;
   is >> error;
@@ -86,7 +86,41 @@ GsmAt::GsmAt(MeTa &meTa) :
 {
 }
 
-std::string GsmAt::chat(std::string atCommand, std::string response,
+bool GsmAt::matchEcho(StringView answer, StringView atCommand)
+{
+  return answer.length() == atCommand.length() + 2 &&
+    answer.startsWith("AT") &&
+    answer.substr(2, atCommand.length()).startsWith(atCommand);
+}
+
+bool GsmAt::matchSetResponse(StringView answer, StringView atCommand)
+{
+  // find the "=" of a set command
+  const char *eq = NULL;
+  if (atCommand.length() > 1)
+    eq = (const char*)memchr(atCommand.data() + 1, '=',
+                             atCommand.length() - 1);
+  if (eq == NULL)
+    return false;
+
+  // compare with "<command>: <parameters>"
+  unsigned int loc = eq - atCommand.data();
+  return answer.startsWith(atCommand.substr(0, loc)) &&
+    answer.substr(loc, answer.length() - loc).startsWith(": ") &&
+    answer.substr(loc + 2, answer.length() - loc - 2).startsWith(
+      atCommand.substr(loc + 1, atCommand.length() - loc - 1));
+}
+
+void GsmAt::putCommand(StringView atCommand) throw(GsmException)
+{
+  std::string line;
+  line.reserve(atCommand.length() + 2);
+  line += "AT";
+  line.append(atCommand.data(), atCommand.length());
+  putLine(line);
+}
+
+std::string GsmAt::chat(StringView atCommand, StringView response,
 			bool ignoreErrors, bool acceptEmptyResponse)
   throw(GsmException)
 {
@@ -95,50 +129,43 @@ std::string GsmAt::chat(std::string atCommand, std::string response,
               acceptEmptyResponse);
 }
 
-std::string GsmAt::chat(std::string atCommand, std::string response, std::string &pdu,
-			bool ignoreErrors, bool expectPdu,
+std::string GsmAt::chat(StringView atCommand, StringView response,
+                        std::string &pdu, bool ignoreErrors, bool expectPdu,
 			bool acceptEmptyResponse) throw(GsmException)
 {
-  std::string s;
+  std::string result;           // the only return value (allows NRVO)
+  StringView s;                 // valid until the next line is read
+  std::string line;             // copy of s if it is needed longer
   bool gotOk = false;           // special handling for empty SMS entries
 
   // send AT command
-  putLine("AT" + atCommand);
+  putCommand(atCommand);
   // and gobble up CR/LF (and possibly echoed characters if echo can't be
   // switched off)
   // Also, some mobiles (e.g., Sony Ericsson K800i) respond to commands
   // like "at+cmgf=0" with "+CMGF: 0" on success as well as the "OK"
   // status -- so gobble that (but not if that sort of response was expected)
   // FIXME: this is a gross hack, should be done via capabilities or sth
-  std::string::size_type loc = atCommand.find( "=", 1 );
-  std::string expect;
-  if (loc != std::string::npos) {
-    expect = atCommand;
-    expect.replace(loc, 1, " ");
-    expect.insert(loc, ":");
-  } else {
-    expect = "";
-  }
   do
     {
-      s = normalize(getLine());
+      s = normalize(getLineView());
     }
-  while (s.length() == 0 || s == "AT" + atCommand || 
+  while (s.length() == 0 || matchEcho(s, atCommand) ||
          ((response.length() == 0 || !matchResponse(s, response)) &&
-          (expect.length() > 0 && matchResponse(s, expect))));
+          matchSetResponse(s, atCommand)));
 
   // handle errors
   if (matchResponse(s, "+CME ERROR:") || matchResponse(s, "+CMS ERROR:"))
     {
       if (ignoreErrors)
-	return "";
+	return result;
       else
-	throwCmeException(s);
+	throwCmeException(s.str());
     }
   if (matchResponse(s, "ERROR"))
     {
       if (ignoreErrors)
-	return "";
+	return result;
       else
 	throw GsmException(_("ME/TA error '<unspecified>' (code not known)"), 
 			   ChatError, -1);
@@ -146,22 +173,24 @@ std::string GsmAt::chat(std::string atCommand, std::string response, std::string
 
   // return if response is "OK" and caller says this is OK
   if (acceptEmptyResponse && s == "OK")
-    return "";
+    return result;
 
   // handle PDU if one is expected
   if (expectPdu)
     {
-      std::string ps;
+      line.assign(s.data(), s.length());
+      s = line;
+      StringView ps;
       do
 	{
-	  ps = normalize(getLine());
+	  ps = normalize(getLineView());
 	}
       while (ps.length() == 0 && ps != "OK");
       if (ps == "OK")
 	gotOk = true;
       else
 	{
-	  pdu = ps;
+	  pdu.assign(ps.data(), ps.length());
 	  // remove trailing zero added by some devices (e.g. Falcom A2-1)
 	  if (pdu.length() > 0 && pdu[pdu.length() - 1] == 0)
 	    pdu.erase(pdu.length() - 1);
@@ -171,18 +200,15 @@ std::string GsmAt::chat(std::string atCommand, std::string response, std::string
   // handle expected response
   if (response.length() == 0)   // no response expected
     {
-      if (s == "OK") return "";
+      if (s == "OK") return result;
       // else fall through to error
     }
   else
     {
-      std::string result;
       // some TA/TEs don't prefix their response with the response string
       // as proscribed by the standard: just handle either case
-      if (matchResponse(s, response))
-	result = cutResponse(s, response);
-      else
-	result = s;
+      StringView r = matchResponse(s, response) ? cutResponse(s, response) : s;
+      result.assign(r.data(), r.length());
 
       if (gotOk)
 	return result;
@@ -191,7 +217,7 @@ std::string GsmAt::chat(std::string atCommand, std::string response, std::string
 	  // get the final "OK"
 	  do
 	    {
-	      s = normalize(getLine());
+	      s = normalize(getLineView());
 	    }
 	  while (s.length() == 0);
 
@@ -201,25 +227,26 @@ std::string GsmAt::chat(std::string atCommand, std::string response, std::string
     }
   throw GsmException(
 		     stringPrintf(_("unexpected response '%s' when sending 'AT%s'"),
-				  s.c_str(), atCommand.c_str()),
+				  s.str().c_str(), atCommand.str().c_str()),
 		     ChatError);
 }
 
-std::vector<std::string> GsmAt::chatv(std::string atCommand, std::string response,
+std::vector<std::string> GsmAt::chatv(StringView atCommand,
+                                      StringView response,
 				      bool ignoreErrors) throw(GsmException)
 {
-  std::string s;
+  StringView s;
   std::vector<std::string> result;
 
   // send AT command
-  putLine("AT" + atCommand);
+  putCommand(atCommand);
   // and gobble up CR/LF (and possibly echoed characters if echo can't be
   // switched off)
   do
     {
-      s = normalize(getLine());
+      s = normalize(getLineView());
     }
-  while (s.length() == 0 || s == "AT" + atCommand);
+  while (s.length() == 0 || matchEcho(s, atCommand));
 
   // handle errors
   if (matchResponse(s, "+CME ERROR:") || matchResponse(s, "+CMS ERROR:"))
@@ -227,7 +254,7 @@ std::vector<std::string> GsmAt::chatv(std::string atCommand, std::string respons
       if (ignoreErrors)
 	return result;
       else
-	throwCmeException(s);
+	throwCmeException(s.str());
     }
   if (matchResponse(s, "ERROR"))
     {
@@ -246,14 +273,14 @@ std::vector<std::string> GsmAt::chatv(std::string atCommand, std::string respons
 	return result;
       // some TA/TEs don't prefix their response with the response string
       // as proscribed by the standard: just handle either case
-      if (response.length() != 0 && matchResponse(s, response))
-	result.push_back(cutResponse(s, response));
-      else
-	result.push_back(s);
+      StringView r = (response.length() != 0 && matchResponse(s, response)) ?
+        cutResponse(s, response) : s;
+      result.push_back(std::string());
+      result.back().assign(r.data(), r.length());
       // get next line
       do
 	{
-	  s = normalize(getLine());
+	  s = normalize(getLineView());
 	}
       while (s.length() == 0);
       reportProgress();
@@ -266,31 +293,27 @@ std::vector<std::string> GsmAt::chatv(std::string atCommand, std::string respons
 
 std::string GsmAt::normalize(std::string s)
 {
-  size_t start = 0, end = s.length();
-  bool changed = true;
+  return normalize(StringView(s)).str();
+}
 
-  while (start < end && changed)
-    {
-      changed = false;
-      if (isspace(s[start]))
-	{
-	  ++start;
-	  changed = true;
-	}
-      else
-	if (isspace(s[end - 1]))
-	  {
-	    --end;
-	    changed = true;
-	  }
-    }
+StringView GsmAt::normalize(StringView s)
+{
+  unsigned int start = 0, end = s.length();
+
+  while (start < end && isspace((unsigned char)s[start]))
+    ++start;
+  while (start < end && isspace((unsigned char)s[end - 1]))
+    --end;
   return s.substr(start, end - start);
 }
 
-std::string GsmAt::sendPdu(std::string atCommand, std::string response, std::string pdu,
-                      bool acceptEmptyResponse) throw(GsmException)
+std::string GsmAt::sendPdu(StringView atCommand, StringView response,
+                           StringView pdu, bool acceptEmptyResponse)
+  throw(GsmException)
 {
+  std::string result;
   std::string s;
+  std::string line;             // pdu followed by CTRL-Z
   bool errorCondition;
   bool retry = false;
   int tries = 5;                // How many error conditions do we accept
@@ -299,7 +322,7 @@ std::string GsmAt::sendPdu(std::string atCommand, std::string response, std::str
   do
     {
       errorCondition = false;
-      putLine("AT" + atCommand);
+      putCommand(atCommand);
       do
 	{
 	  retry = false;
@@ -323,7 +346,7 @@ std::string GsmAt::sendPdu(std::string atCommand, std::string response, std::str
 	  if (c == '+' || c == 'E') // error or unsolicited result code
 	    {
 	      _port->putBack(c);
-	      s = normalize(getLine());
+	      s = normalize(getLineView()).str();
 	      errorCondition = (s != "");
 
 	      retry = ! errorCondition;
@@ -340,7 +363,10 @@ std::string GsmAt::sendPdu(std::string atCommand, std::string response, std::str
 	throw GsmException(_("unexpected character in PDU handshake"),
 			   ChatError);
 
-      putLine(pdu + "\032", false); // write pdu followed by CTRL-Z
+      line.reserve(pdu.length() + 1);
+      line.append(pdu.data(), pdu.length());
+      line += '\032';
+      putLine(line, false);     // write pdu followed by CTRL-Z
 
       // some phones (Ericcson T68, T39) send spurious zero characters after
       // accepting the PDU
@@ -353,9 +379,9 @@ std::string GsmAt::sendPdu(std::string atCommand, std::string response, std::str
       // is read
       do
 	{
-	  s = normalize(getLine());
+	  s = normalize(getLineView()).str();
 	}
-      while (s.length() == 0 || s == pdu || s == (pdu + "\032") ||
+      while (s.length() == 0 || pdu == s || s == line ||
 	     (s.length() == 1 && s[0] == 0));
     }
 
@@ -368,15 +394,16 @@ std::string GsmAt::sendPdu(std::string atCommand, std::string response, std::str
 
   // return if response is "OK" and caller says this is OK
   if (acceptEmptyResponse && s == "OK")
-    return "";
+    return result;
 
   if (matchResponse(s, response))
     {
-      std::string result = cutResponse(s, response);
+      StringView r = cutResponse(s, response);
+      result.assign(r.data(), r.length());
       // get the final "OK"
       do
 	{
-	  s = normalize(getLine());
+	  s = normalize(getLineView()).str();
 	}
       while (s.length() == 0);
 
@@ -385,23 +412,28 @@ std::string GsmAt::sendPdu(std::string atCommand, std::string response, std::str
     }
   throw GsmException(
 		     stringPrintf(_("unexpected response '%s' when sending 'AT%s'"),
-				  s.c_str(), atCommand.c_str()),
+				  s.c_str(), atCommand.str().c_str()),
 		     ChatError);
 }
 
 std::string GsmAt::getLine() throw(GsmException)
+{
+  return getLineView().str();
+}
+
+StringView GsmAt::getLineView() throw(GsmException)
 {
   if (_eventHandler == (GsmEvent*)NULL)
-    return _port->getLine();
+    return _port->getLineView();
   else
     {
       bool eventOccurred;
-      std::string result;
+      StringView result;
       do
 	{
 	  eventOccurred = false;
-	  result = _port->getLine();
-	  std::string s = normalize(result);
+	  result = _port->getLineView();
+	  StringView s = normalize(result);
 	  if (matchResponse(s, "+CMT:") ||
 	      matchResponse(s, "+CBM:") ||
 	      matchResponse(s, "+CDS:") ||
@@ -414,7 +446,7 @@ std::string GsmAt::getLine() throw(GsmException)
 	      // which is NOT an unsolicited result code
 	      (matchResponse(s, "+CLIP:") && s.length() > 10))
 	    {
-	      _eventHandler->dispatch(s, *this);
+	      _eventHandler->dispatch(s.str(), *this);
 	      eventOccurred = true;
 	    }
 	}
@@ -423,13 +455,13 @@ std::string GsmAt::getLine() throw(GsmException)
     }
 }
 
-void GsmAt::putLine(std::string line,
+void GsmAt::putLine(const std::string &line,
                     bool carriageReturn) throw(GsmException)
 {
   _port->putLine(line, carriageReturn);
   // remove empty echo line
   if (carriageReturn)
-    getLine();
+    getLineView();
 }
 
 bool GsmAt::wait(GsmTime timeout) throw(GsmException)
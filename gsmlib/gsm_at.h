@@ -34,10 +34,20 @@ namespace gsmlib
     GsmEvent *_eventHandler;
     
     // return true if response matches
-    bool matchResponse(std::string answer, std::string responseToMatch);
+    bool matchResponse(StringView answer, StringView responseToMatch);
 
     // cut response and normalize
-    std::string cutResponse(std::string answer, std::string responseToMatch);
+    StringView cutResponse(StringView answer, StringView responseToMatch);
+
+    // return true if answer is the echo of atCommand
+    static bool matchEcho(StringView answer, StringView atCommand);
+
+    // return true if answer is of the form "+XXX: n" and atCommand is
+    // the set command "+XXX=n"
+    static bool matchSetResponse(StringView answer, StringView atCommand);
+
+    // send "AT" + atCommand
+    void putCommand(StringView atCommand) throw(GsmException);
 
     // parse CME error contained in string and throw MeTaException
     void throwCmeException(std::string s) throw(GsmException);
@@ -59,37 +69,41 @@ namespace gsmlib
     // additionally, accept empty responses (just an OK)
     //   if acceptEmptyResponse == true
     //   in this case an empty string is returned
-    std::string chat(std::string atCommand = "",
-		     std::string response = "",
+    // atCommand and response are not copied
+    std::string chat(StringView atCommand = "",
+		     StringView response = "",
 		     bool ignoreErrors = false,
 		     bool acceptEmptyResponse = false) throw(GsmException);
 
     // same as chat() above but also get pdu if expectPdu == true
-    std::string chat(std::string atCommand,
-		     std::string response,
+    std::string chat(StringView atCommand,
+		     StringView response,
 		     std::string &pdu,
 		     bool ignoreErrors = false,
 		     bool expectPdu = true,
 		     bool acceptEmptyResponse = false) throw(GsmException);
 
     // same as above, but expect several response lines
-    std::vector<std::string> chatv(std::string atCommand = "",
-				   std::string response = "",
+    std::vector<std::string> chatv(StringView atCommand = "",
+				   StringView response = "",
 				   bool ignoreErrors = false)
       throw(GsmException);
 
     // removes whitespace at beginning and end of string
     std::string normalize(std::string s);
+    StringView normalize(StringView s);
 
     // send pdu (wait for <CR><LF><greater_than><space> and send <CTRL-Z>
     // at the end
     // return text after response
-    std::string sendPdu(std::string atCommand, std::string response, std::string pdu,
+    std::string sendPdu(StringView atCommand, StringView response,
+                        StringView pdu,
 			bool acceptEmptyResponse = false) throw(GsmException);
     
     // functions from class Port
     std::string getLine() throw(GsmException);
-    void putLine(std::string line,
+    StringView getLineView() throw(GsmException);
+    void putLine(const std::string &line,
                  bool carriageReturn = true) throw(GsmException);
     bool wait(GsmTime timeout) throw(GsmException);
     int readByte() throw(GsmException);
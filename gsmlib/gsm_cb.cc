@@ -173,6 +173,6 @@ std::string CBMessage::toString() const
      << _("Total page number: ") << _totalPageNumber << std::endl
      << _("Current page number: ") << _currentPageNumber << std::endl
      << _("Data: '") << data << "'" << std::endl
-     << dashes << std::endl << std::endl << std::ends;
+     << dashes << std::endl << std::endl;
   return os.str();
 }
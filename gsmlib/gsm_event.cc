@@ -90,6 +90,10 @@ void GsmEvent::dispatch(std::string s, GsmAt &at) throw(GsmException)
       if (p.parseComma(true))
         alpha = p.parseString(true);
     }
+
+    // look up name of caller
+    if (alpha.length() == 0 && ! _numberIndex.isnull())
+      _numberIndex->find(num, alpha);
     
     // call the event handler
     callerLineID(num, subAddr, alpha);
@@ -107,6 +111,11 @@ void GsmEvent::dispatch(std::string s, GsmAt &at) throw(GsmException)
     std::string storeName = p.parseString();
     p.parseComma();
     unsigned int index = p.parseInt();
+
+    // the entry in a cached SMS store is out of date now
+    // (the store ignores invalid indices)
+    at.getMeTa().invalidateSMSStoreEntry(storeName, index - 1);
+
     SMSReceptionIndication(storeName, index - 1, messageType);
   }
   else
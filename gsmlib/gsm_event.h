@@ -15,6 +15,7 @@
 
 #include <gsmlib/gsm_sms.h>
 #include <gsmlib/gsm_cb.h>
+#include <gsmlib/gsm_number_index.h>
 
 namespace gsmlib
 {
@@ -27,17 +28,25 @@ namespace gsmlib
   class GsmEvent
   {
   private:
+    NumberIndexRef _numberIndex; // used to annotate CLIP events
+
     // dispatch CMT/CBR/CDS/CLIP etc.
     void dispatch(std::string s, GsmAt &at) throw(GsmException);
 
   public:
     virtual ~GsmEvent() { }
 
+    // set index used to look up the names of callers
+    void setNumberIndex(const NumberIndexRef &numberIndex)
+      {_numberIndex = numberIndex;}
+
     // for SMSReception, type of SMS
     enum SMSMessageType {NormalSMS, CellBroadcastSMS, StatusReportSMS};
 
     // caller line identification presentation
     // only called if setCLIPEvent(true) is set
+    // if the ME does not report alpha and a number index is set, alpha
+    // is the text found in the index
     virtual void callerLineID(std::string number, std::string subAddr, std::string alpha);
 
     // called if the string NO CARRIER is read
@@ -23,12 +23,18 @@ namespace gsmlib
   enum SortOrder {ByText = 0, ByTelephone = 1, ByIndex = 2, ByDate = 3,
                   ByType = 4, ByAddress = 5};
 
+  // number of different sort orders (size of per-order index arrays)
+  const int SORT_ORDER_COUNT = ByAddress + 1;
+
   // wrapper for map key, can access Sortedtore to get sortOrder()
+  // the sort order is fixed when the key is created, so that maps with
+  // different sort orders can exist side by side for the same store
 
   template <class SortedStore> class MapKey
   {
   public:
     SortedStore &_myStore;   // my store
+    SortOrder _sortOrder;     // sort order this key is compared by
     // different type keys
     Address _addressKey;
     Timestamp _timeKey;
@@ -37,14 +43,25 @@ namespace gsmlib
 
   public:
     // constructors for the different sort keys
+    // (use the current sort order of the store)
     MapKey(SortedStore &myStore, Address key) :
-      _myStore(myStore), _addressKey(key) {}
+      _myStore(myStore), _sortOrder(myStore.sortOrder()), _addressKey(key) {}
     MapKey(SortedStore &myStore, Timestamp key) :
-      _myStore(myStore), _timeKey(key) {}
+      _myStore(myStore), _sortOrder(myStore.sortOrder()), _timeKey(key) {}
     MapKey(SortedStore &myStore, int key) :
-      _myStore(myStore), _intKey(key) {}
+      _myStore(myStore), _sortOrder(myStore.sortOrder()), _intKey(key) {}
     MapKey(SortedStore &myStore, std::string key) :
-      _myStore(myStore), _strKey(key) {}
+      _myStore(myStore), _sortOrder(myStore.sortOrder()), _strKey(key) {}
+
+    // same as above, but for an explicitly given sort order
+    MapKey(SortedStore &myStore, SortOrder sortOrder, Address key) :
+      _myStore(myStore), _sortOrder(sortOrder), _addressKey(key) {}
+    MapKey(SortedStore &myStore, SortOrder sortOrder, Timestamp key) :
+      _myStore(myStore), _sortOrder(sortOrder), _timeKey(key) {}
+    MapKey(SortedStore &myStore, SortOrder sortOrder, int key) :
+      _myStore(myStore), _sortOrder(sortOrder), _intKey(key) {}
+    MapKey(SortedStore &myStore, SortOrder sortOrder, std::string key) :
+      _myStore(myStore), _sortOrder(sortOrder), _strKey(key) {}
 
 /*
     friend
@@ -79,8 +96,9 @@ namespace gsmlib
                            const MapKey<SortedStore> &y)
     {
       assert(&x._myStore == &y._myStore);
+      assert(x._sortOrder == y._sortOrder);
 
-      switch (x._myStore.sortOrder())
+      switch (x._sortOrder)
       {
       case ByDate:
         return x._timeKey < y._timeKey;
@@ -104,8 +122,9 @@ namespace gsmlib
                             const MapKey<SortedStore> &y)
     {
       assert(&x._myStore == &y._myStore);
+      assert(x._sortOrder == y._sortOrder);
 
-      switch (x._myStore.sortOrder())
+      switch (x._sortOrder)
       {
       case ByDate:
         return x._timeKey == y._timeKey;
@@ -20,6 +20,7 @@
 #include <gsmlib/gsm_sysdep.h>
 
 #include <cstdlib>
+#include <iostream>
 
 using namespace gsmlib;
 
@@ -38,6 +39,34 @@ Capabilities::Capabilities() :
 {
 }
 
+// aux function for MeTa::getMEInfo() and MeTa::profiledChat()
+
+static std::string stringVectorToString(const std::vector<std::string>& v,
+					char separator = '\n')
+{
+  if (v.empty())
+    return "";
+
+  // concatenate string in vector as rows
+  std::string result;
+  for (std::vector<std::string>::const_iterator i = v.begin();;)
+  {
+    std::string s = *i;
+    // remove leading and trailing "s
+    if (s.length() > 0 && s[0] == '"')
+      s.erase(s.begin());
+    if (s.length() > 0 && s[s.length() - 1] == '"')
+      s.erase(s.end() - 1);
+
+    result += s;
+    // don't add end line to last
+    if ( ++i == v.end() || !separator)
+      break;
+    result += separator;
+  }
+  return result;
+}
+
 // MeTa members
 
 void MeTa::init() throw(GsmException)
@@ -49,6 +78,32 @@ void MeTa::init() throw(GsmException)
   // select SMS pdu mode
   _at->chat("+CMGF=0");
 
+  // look up the profile of this ME in the cache file
+  // if the ME is known, these are the only queries needed to fill in the
+  // capability object
+  const char *profileCache = getenv("GSMLIB_PROFILE_CACHE");
+  if (profileCache != NULL && *profileCache != 0)
+  {
+    std::string serialNumber =
+      stringVectorToString(_at->chatv("+CGSN", "+CGSN:", false), 0);
+    if (serialNumber != "")
+      try
+      {
+        // same format as profiledChat("+CGMR", "+CGMR:", true)
+        std::string revision =
+          stringVectorToString(_at->chatv("+CGMR", "+CGMR:", false));
+        _profile = new MeTaProfile(profileCache, serialNumber, revision);
+      }
+      catch (GsmException &e)
+      {
+        // the profile is only an optimisation, carry on without it
+#ifndef NDEBUG
+        if (debugLevel() >= 1)
+          std::cerr << "*** " << e.what() << std::endl;
+#endif // NDEBUG
+      }
+  }
+
   // now fill in capability object
   MEInfo info = getMEInfo();
   
@@ -87,18 +142,10 @@ void MeTa::init() throw(GsmException)
   } 
 
   // find out whether we are supposed to send an acknowledgment
-  Parser p(_at->chat("+CSMS?", "+CSMS:"));
-  try {
-    _capabilities._sendAck = p.parseInt() >= 1;
-  }
-  catch (GsmException &e)
-  {
-    if (e.getErrorClass() == ParserError) {
-      _capabilities._sendAck = 0;
-    } else {
-      throw e;
-    }
-  }
+  std::string csms = profiledChat("+CSMS?", "+CSMS:");
+  ParserView p(csms);
+  int service;
+  _capabilities._sendAck = p.parseInt(service) == ParseOK && service >= 1;
       
   // set GSM default character set
   try
@@ -124,6 +171,35 @@ MeTa::MeTa(Ref<Port> port) throw(GsmException) : _port(port)
   init();
 }
 
+std::string MeTa::profiledChat(std::string atCommand, std::string response,
+                               bool multiLine) throw(GsmException)
+{
+  std::string result;
+  if (! _profile.isnull() && _profile->lookup(atCommand, result))
+    return result;
+
+  if (multiLine)
+    result = stringVectorToString(_at->chatv(atCommand, response, false));
+  else
+    result = _at->chat(atCommand, response);
+
+  if (! _profile.isnull())
+    try
+    {
+      _profile->set(atCommand, result);
+    }
+    catch (GsmException &e)
+    {
+      // cache file not writable, carry on without the profile
+#ifndef NDEBUG
+      if (debugLevel() >= 1)
+        std::cerr << "*** " << e.what() << std::endl;
+#endif // NDEBUG
+      _profile = MeTaProfileRef();
+    }
+  return result;
+}
+
 // MeTa::MeTa(Ref<GsmAt> at) throw(GsmException) :
 //   _at(at)
 // {
@@ -157,7 +233,7 @@ std::string MeTa::setSMSStore(std::string smsStore, int storeTypes, bool needRes
   {
     // count the number of parameters for the CPMS AT sequences
     _capabilities._cpmsParamCount = 1;
-    Parser p(_at->chat("+CPMS=?", "+CPMS:"));
+    Parser p(profiledChat("+CPMS=?", "+CPMS:"));
     p.parseStringList();
     while (p.parseComma(true))
     {
@@ -213,53 +289,27 @@ void MeTa::waitEvent(GsmTime timeout) throw(GsmException)
     _at->chat();                // send AT, wait for OK, handle events
 }
 
-// aux function for MeTa::getMEInfo()
-
-static std::string stringVectorToString(const std::vector<std::string>& v,
-					char separator = '\n')
-{
-  if (v.empty())
-    return "";
-
-  // concatenate string in vector as rows
-  std::string result;
-  for (std::vector<std::string>::const_iterator i = v.begin();;)
-  {
-    std::string s = *i;
-    // remove leading and trailing "s
-    if (s.length() > 0 && s[0] == '"')
-      s.erase(s.begin());
-    if (s.length() > 0 && s[s.length() - 1] == '"')
-      s.erase(s.end() - 1);
-
-    result += s;
-    // don't add end line to last
-    if ( ++i == v.end() || !separator)
-      break;
-    result += separator;
-  }
-  return result;
-}
-
 MEInfo MeTa::getMEInfo() throw(GsmException)
 {
   MEInfo result;
   // some TAs just return OK and no info line
   // leave the info empty in this case
   // some TAs return multirows with info like address, firmware version
-  result._manufacturer =
-    stringVectorToString(_at->chatv("+CGMI", "+CGMI:", false));
-  result._model = stringVectorToString(_at->chatv("+CGMM", "+CGMM:", false));
-  result._revision =
-    stringVectorToString(_at->chatv("+CGMR", "+CGMR:", false));
-  result._serialNumber =
-    stringVectorToString(_at->chatv("+CGSN", "+CGSN:", false),0);
+  result._manufacturer = profiledChat("+CGMI", "+CGMI:", true);
+  result._model = profiledChat("+CGMM", "+CGMM:", true);
+  result._revision = profiledChat("+CGMR", "+CGMR:", true);
+  // the profile was selected by the serial number
+  if (_profile.isnull())
+    result._serialNumber =
+      stringVectorToString(_at->chatv("+CGSN", "+CGSN:", false),0);
+  else
+    result._serialNumber = _profile->serialNumber();
   return result;
 }
 
 std::vector<std::string> MeTa::getSupportedCharSets() throw(GsmException)
 {
-  Parser p(_at->chat("+CSCS=?", "+CSCS:"));
+  Parser p(profiledChat("+CSCS=?", "+CSCS:"));
   return p.parseStringList();
 }
     
@@ -875,7 +925,7 @@ int MeTa::getBitErrorRate() throw(GsmException)
 
 std::vector<std::string> MeTa::getPhoneBookStrings() throw(GsmException)
 {
-  Parser p(_at->chat("+CPBS=?", "+CPBS:"));
+  Parser p(profiledChat("+CPBS=?", "+CPBS:"));
   return p.parseStringList();
 }
 
@@ -915,7 +965,7 @@ void MeTa::setServiceCentreAddress(std::string sca) throw(GsmException)
 
 std::vector<std::string> MeTa::getSMSStoreNames() throw(GsmException)
 {
-  Parser p(_at->chat("+CPMS=?", "+CPMS:"));
+  Parser p(profiledChat("+CPMS=?", "+CPMS:"));
   // only return <mem1> values
   return p.parseStringList();
 }
@@ -933,13 +983,21 @@ SMSStoreRef MeTa::getSMSStore(std::string storeName) throw(GsmException)
   return newSs;
 }
 
-void MeTa::sendSMS(Ref<SMSSubmitMessage> smsMessage) throw(GsmException)
+void MeTa::invalidateSMSStoreEntry(std::string storeName, int index)
+{
+  for (SMSStoreVector::iterator i = _smsStoreCache.begin();
+       i !=  _smsStoreCache.end(); ++i)
+    if ((*i)->name() == storeName)
+      (*i)->invalidateEntry(index);
+}
+
+void MeTa::sendSMS(const Ref<SMSSubmitMessage> &smsMessage) throw(GsmException)
 {
   smsMessage->setAt(_at);
   smsMessage->send();
 }
 
-void MeTa::sendSMSs(Ref<SMSSubmitMessage> smsTemplate, std::string text,
+void MeTa::sendSMSs(const Ref<SMSSubmitMessage> &smsTemplate, std::string text,
                     bool oneSMS,
                     int concatenatedMessageId)
   throw(GsmException)
@@ -1022,6 +1080,17 @@ void MeTa::setMessageService(int serviceLevel) throw(GsmException)
   }
   // some devices (eg. Origo 900) don't support service level setting
   _at->chat("+CSMS=" + s, "+CSMS:", true);
+
+  // the profile holds the service level found by init()
+  if (! _profile.isnull())
+    try
+    {
+      _profile->erase("+CSMS?");
+    }
+    catch (GsmException &e)
+    {
+      _profile = MeTaProfileRef();
+    }
 }
 
 unsigned int MeTa::getMessageService() throw(GsmException)
@@ -1085,38 +1154,38 @@ void MeTa::setSMSRoutingToTA(bool enableSMS, bool enableCBS,
   bool bufferModesSet = false;
 
   // find out capabilities
-  Parser p(_at->chat("+CNMI=?", "+CNMI:"));
-  std::vector<bool> modes = p.parseIntList();
-  std::vector<bool> smsModes(1);
-  std::vector<bool> cbsModes(1);
-  std::vector<bool> statModes(1);
-  std::vector<bool> bufferModes(1);
+  Parser p(profiledChat("+CNMI=?", "+CNMI:"));
+  IntSet modes = p.parseIntSet();
+  IntSet smsModes;
+  IntSet cbsModes;
+  IntSet statModes;
+  IntSet bufferModes;
   if (p.parseComma(true))
   {
-    smsModes = p.parseIntList();
+    smsModes = p.parseIntSet();
     smsModesSet = true;
     if (p.parseComma(true))
     {
-      cbsModes = p.parseIntList();
+      cbsModes = p.parseIntSet();
       cbsModesSet = true;
       if (p.parseComma(true))
       {
-        statModes = p.parseIntList();
+        statModes = p.parseIntSet();
         statModesSet = true;
         if (p.parseComma(true))
         {
-          bufferModes = p.parseIntList();
+          bufferModes = p.parseIntSet();
           bufferModesSet = true;
         }
       }
     }
   }
 
-  // now set the mode vectors to the default if not set
-  if (! smsModesSet) smsModes[0] = true;
-  if (! cbsModesSet) cbsModes[0] = true;
-  if (! statModesSet) statModes[0] = true;
-  if (! bufferModesSet) bufferModes[0] = true;
+  // now set the mode sets to the default if not set
+  if (! smsModesSet) smsModes.insert(0);
+  if (! cbsModesSet) cbsModes.insert(0);
+  if (! statModesSet) statModes.insert(0);
+  if (! bufferModesSet) bufferModes.insert(0);
   
   std::string chatString;
     
@@ -21,6 +21,7 @@
 #include <gsmlib/gsm_util.h>
 #include <gsmlib/gsm_at.h>
 #include <gsmlib/gsm_sms.h>
+#include <gsmlib/gsm_me_ta_profile.h>
 #include <string>
 #include <vector>
 
@@ -127,10 +128,22 @@ namespace gsmlib
     GsmEvent _defaultEventHandler; // default event handler
                                 // see comments in MeTa::init()
     std::string _lastCharSet;        // remember last character set
+    MeTaProfileRef _profile;    // cached query results, may be NULL
 
     // init ME/TA to sensible defaults
+    // if the environment variable GSMLIB_PROFILE_CACHE names a file,
+    // query results are cached there (see gsm_me_ta_profile.h)
     void init() throw(GsmException);
 
+    // chat() for queries whose results are kept in the profile
+    // if multiLine == true, the lines of the result are joined with LF
+    std::string profiledChat(std::string atCommand, std::string response,
+                             bool multiLine = false) throw(GsmException);
+
+    // mark entry index of SMS store storeName as not cached
+    // called by GsmEvent when the ME indicates a new message in a store
+    void invalidateSMSStoreEntry(std::string storeName, int index);
+
   public:
     // initialize a new MeTa object given the port
     MeTa(Ref<Port> port) throw(GsmException);
@@ -338,7 +351,7 @@ namespace gsmlib
     SMSStoreRef getSMSStore(std::string storeName) throw(GsmException);
 
     // send a single SMS message
-    void sendSMS(Ref<SMSSubmitMessage> smsMessage) throw(GsmException);
+    void sendSMS(const Ref<SMSSubmitMessage> &smsMessage) throw(GsmException);
 
     // send one or several (concatenated) SMS messages
     // The SUBMIT message template must have all options set, only
@@ -347,7 +360,7 @@ namespace gsmlib
     // are sent. If concatenatedMessageId is != -1 this is used as the message
     // ID for concatenated SMS (for this a user data header as defined in
     // GSM GTS 3.40 is used, the old UDH in the template is overwritten).
-    void sendSMSs(Ref<SMSSubmitMessage> smsTemplate, std::string text,
+    void sendSMSs(const Ref<SMSSubmitMessage> &smsTemplate, std::string text,
                   bool oneSMS = false,
                   int concatenatedMessageId = -1)
       throw(GsmException);
@@ -394,6 +407,7 @@ namespace gsmlib
 
     friend class Phonebook;
     friend class SMSStore;
+    friend class GsmEvent;
   };
 };
 
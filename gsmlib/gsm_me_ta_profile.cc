@@ -0,0 +1,144 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_me_ta_profile.cc
+// *
+// * Purpose: Cache of ME/TA capability query results
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_nls.h>
+#include <gsmlib/gsm_me_ta_profile.h>
+#include <gsmlib/gsm_sysdep.h>
+#include <fstream>
+#include <iterator>
+#include <errno.h>
+#include <stdio.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+using namespace gsmlib;
+
+// MeTaProfile members
+
+void MeTaProfile::load() throw(GsmException)
+{
+  std::ifstream ifs(_filename.c_str(), std::ios::in | std::ios::binary);
+  if (! ifs)
+    return;                     // no cache yet
+  std::string data((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  if (ifs.bad())
+    throw GsmException(stringPrintf(_("error reading from file '%s'"),
+                                    _filename.c_str()),
+                       OSError);
+
+  const char *p = data.data();
+  const char *end = p + data.length();
+  while (p != end)
+  {
+    if (*p == CR || *p == LF)
+    {
+      ++p;
+      continue;                 // skip empty lines
+    }
+
+    // line format: serial number '|' AT command '|' result
+    const char *line = p;
+    std::string serialNumber = unescapeString(p, end);
+    bool valid = p != end && *p++ == '|';
+    std::string atCommand, result;
+    if (valid)
+    {
+      atCommand = unescapeString(p, end);
+      valid = p != end && *p++ == '|';
+    }
+    if (valid)
+      result = unescapeString(p, end);
+    valid = valid && (p == end || *p == CR || *p == LF);
+
+    // skip to next line
+    while (p != end && *p != LF)
+      ++p;
+
+    if (! valid)
+      continue;
+    if (serialNumber == _serialNumber)
+      _results[atCommand] = result;
+    else
+    {
+      _otherLines.append(line, p - line);
+      _otherLines += '\n';
+    }
+  }
+}
+
+MeTaProfile::MeTaProfile(std::string filename, std::string serialNumber,
+                         std::string revision)
+  throw(GsmException) : _filename(filename), _serialNumber(serialNumber)
+{
+  load();
+
+  // the results of another firmware revision are stale
+  std::string cachedRevision;
+  if (! lookup("+CGMR", cachedRevision) || cachedRevision != revision)
+  {
+    _results.clear();
+    _results["+CGMR"] = revision;
+  }
+}
+
+bool MeTaProfile::lookup(std::string atCommand, std::string &result) const
+{
+  std::map<std::string, std::string>::const_iterator i =
+    _results.find(atCommand);
+  if (i == _results.end())
+    return false;
+  result = i->second;
+  return true;
+}
+
+void MeTaProfile::set(std::string atCommand, std::string result)
+  throw(GsmException)
+{
+  _results[atCommand] = result;
+  save();
+}
+
+void MeTaProfile::erase(std::string atCommand) throw(GsmException)
+{
+  if (_results.erase(atCommand) != 0)
+    save();
+}
+
+void MeTaProfile::save() throw(GsmException)
+{
+  // other processes may be using the cache file, so write a new file
+  // that replaces the old one when it is complete and on disk
+  std::string buffer = _otherLines;
+  std::string serialNumber = escapeString(_serialNumber);
+  for (std::map<std::string, std::string>::const_iterator i =
+         _results.begin(); i != _results.end(); ++i)
+  {
+    buffer += serialNumber;
+    buffer += '|';
+    buffer += escapeString(i->first);
+    buffer += '|';
+    buffer += escapeString(i->second);
+    buffer += '\n';
+  }
+
+  // each process uses its own new file
+#ifdef HAVE_UNISTD_H
+  std::string newFilename =
+    stringPrintf("%s.%d.new", _filename.c_str(), (int)getpid());
+#else
+  std::string newFilename = _filename + ".new";
+#endif
+  replaceFile(_filename, newFilename, buffer);
+}
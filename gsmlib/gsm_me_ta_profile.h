@@ -0,0 +1,67 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_me_ta_profile.h
+// *
+// * Purpose: Cache of ME/TA capability query results
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef GSM_ME_TA_PROFILE_H
+#define GSM_ME_TA_PROFILE_H
+
+#include <gsmlib/gsm_error.h>
+#include <gsmlib/gsm_util.h>
+#include <string>
+#include <map>
+
+namespace gsmlib
+{
+  // The class MeTaProfile holds the results of the queries MeTa uses to
+  // find out about an ME/TA (ME information, supported character sets,
+  // SMS stores, SMS routing modes, ...)
+  // - the profiles of all MEs are kept in one cache file, one line per
+  //   query of the form serial number '|' AT command '|' result
+  // - the profile of an ME is selected by its serial number (+CGSN),
+  //   it is discarded if the firmware revision (+CGMR) has changed
+  // - only results that don't change while the ME is in use should be
+  //   stored here (usually those of test commands "AT+XXX=?")
+
+  class MeTaProfile : public RefBase, public NoCopy
+  {
+  private:
+    std::string _filename;      // name of the cache file
+    std::string _serialNumber;  // serial number of this ME
+    std::map<std::string, std::string> _results; // results of this ME
+    std::string _otherLines;    // lines of other MEs in the cache file
+
+    // read cache file, ignore malformed lines
+    void load() throw(GsmException);
+
+  public:
+    // read the profile of the ME with serialNumber and revision from the
+    // cache file
+    // a missing cache file is treated as empty
+    MeTaProfile(std::string filename, std::string serialNumber,
+                std::string revision) throw(GsmException);
+
+    // return serial number of the ME
+    std::string serialNumber() const {return _serialNumber;}
+
+    // return true and the result if the query is in the profile
+    bool lookup(std::string atCommand, std::string &result) const;
+
+    // add or remove result of query
+    // the cache file is written immediately
+    void set(std::string atCommand, std::string result) throw(GsmException);
+    void erase(std::string atCommand) throw(GsmException);
+
+    // write cache file
+    void save() throw(GsmException);
+  };
+
+  typedef Ref<MeTaProfile> MeTaProfileRef;
+};
+
+#endif // GSM_ME_TA_PROFILE_H
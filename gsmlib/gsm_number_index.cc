@@ -0,0 +1,173 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_number_index.cc
+// *
+// * Purpose: Reverse lookup of telephone numbers in phonebooks
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_number_index.h>
+#include <ctype.h>
+
+using namespace gsmlib;
+
+// NumberIndex members
+
+NumberIndex::Node::Node() : _entry(-1), _any(-1)
+{
+  for (int i = 0; i < 10; ++i)
+    _child[i] = -1;
+}
+
+int NumberIndex::lookup(const std::vector<Node> &trie,
+                        const std::string &digits)
+{
+  int node = 0;
+  for (std::string::const_iterator i = digits.begin(); i != digits.end(); ++i)
+    if ((node = trie[node]._child[*i - '0']) == -1)
+      return -1;
+  return trie[node]._entry;
+}
+
+void NumberIndex::setAny(Node &node, int entry) const
+{
+  if (node._any == -1)
+    node._any = entry;
+  else if (node._any != AMBIGUOUS && _texts[node._any] != _texts[entry])
+    node._any = AMBIGUOUS;
+}
+
+void NumberIndex::insert(std::vector<Node> &trie, const std::string &digits,
+                         int entry)
+{
+  int node = 0;
+  for (std::string::const_iterator i = digits.begin(); i != digits.end(); ++i)
+  {
+    setAny(trie[node], entry);
+    int d = *i - '0';
+    if (trie[node]._child[d] == -1)
+    {
+      // trie may be reallocated by push_back()
+      trie.push_back(Node());
+      trie[node]._child[d] = trie.size() - 1;
+    }
+    node = trie[node]._child[d];
+  }
+  setAny(trie[node], entry);
+  trie[node]._entry = entry;
+}
+
+NumberIndex::NumberIndex(std::string countryCode, std::string trunkPrefix,
+                         std::string iddPrefix, unsigned int minSuffix) :
+  _countryCode(countryCode), _trunkPrefix(trunkPrefix),
+  _iddPrefix(iddPrefix), _minSuffix(minSuffix)
+{
+  clear();
+}
+
+std::string NumberIndex::normalize(std::string telephone) const
+{
+  std::string digits;
+  bool international = false;
+  for (std::string::iterator i = telephone.begin(); i != telephone.end(); ++i)
+    if (isdigit(*i))
+      digits += *i;
+    else if (*i == '+' && digits.length() == 0)
+      international = true;
+
+  if (international)
+    return digits;
+  if (_iddPrefix.length() > 0 &&
+      digits.substr(0, _iddPrefix.length()) == _iddPrefix)
+    return digits.substr(_iddPrefix.length());
+  if (_countryCode.length() > 0 && _trunkPrefix.length() > 0 &&
+      digits.substr(0, _trunkPrefix.length()) == _trunkPrefix)
+    return _countryCode + digits.substr(_trunkPrefix.length());
+  return digits;
+}
+
+void NumberIndex::add(std::string telephone, std::string text)
+{
+  std::string digits = normalize(telephone);
+  if (digits.length() == 0)
+    return;
+
+  std::string reversed(digits.rbegin(), digits.rend());
+  if (lookup(_suffixes, reversed) != -1)
+    return;                     // first entry with this number wins
+
+  int entry = _texts.size();
+  _texts.push_back(text);
+  insert(_suffixes, reversed, entry);
+  insert(_prefixes, digits, entry);
+}
+
+void NumberIndex::add(SortedPhonebookBase &phonebook) throw(GsmException)
+{
+  for (SortedPhonebookBase::iterator i = phonebook.begin();
+       i != phonebook.end(); ++i)
+    if (! i->empty())
+      add(i->telephone(), i->text());
+}
+
+void NumberIndex::clear()
+{
+  _suffixes.clear();
+  _suffixes.push_back(Node());
+  _prefixes.clear();
+  _prefixes.push_back(Node());
+  _texts.clear();
+}
+
+bool NumberIndex::find(std::string telephone, std::string &text) const
+{
+  std::string digits = normalize(telephone);
+  if (digits.length() == 0)
+    return false;
+
+  // longest common suffix
+  // there is no match if the suffix is shared by several contacts
+  int node = 0, best = -1;
+  unsigned int depth = 0;
+  for (std::string::reverse_iterator i = digits.rbegin();
+       i != digits.rend(); ++i)
+  {
+    int child = _suffixes[node]._child[*i - '0'];
+    if (child == -1)
+      break;
+    node = child;
+    if (++depth >= _minSuffix)
+      best = _suffixes[node]._any == AMBIGUOUS ? -1 :
+        _suffixes[node]._entry != -1 ?
+        _suffixes[node]._entry : _suffixes[node]._any;
+  }
+  // exact matches of short numbers are accepted as well
+  if (depth == digits.length() && _suffixes[node]._entry != -1)
+    best = _suffixes[node]._entry;
+
+  // longest entry that is a prefix of the number
+  if (best == -1)
+  {
+    node = 0;
+    depth = 0;
+    for (std::string::iterator i = digits.begin(); i != digits.end(); ++i)
+    {
+      int child = _prefixes[node]._child[*i - '0'];
+      if (child == -1)
+        break;
+      node = child;
+      if (++depth >= _minSuffix && _prefixes[node]._entry != -1)
+        best = _prefixes[node]._entry;
+    }
+  }
+
+  if (best == -1)
+    return false;
+  text = _texts[best];
+  return true;
+}
@@ -0,0 +1,103 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_number_index.h
+// *
+// * Purpose: Reverse lookup of telephone numbers in phonebooks
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef GSM_NUMBER_INDEX_H
+#define GSM_NUMBER_INDEX_H
+
+#include <gsmlib/gsm_sorted_phonebook_base.h>
+#include <gsmlib/gsm_util.h>
+#include <string>
+#include <vector>
+
+namespace gsmlib
+{
+  // minimum number of trailing digits that must agree for a suffix match
+  const unsigned int DEFAULT_NUMBER_INDEX_MIN_SUFFIX = 7;
+
+  // The class NumberIndex maps telephone numbers to the texts of the
+  // phonebook entries they belong to, eg. to display the name of a caller
+  // - numbers are normalized to digits in international format without
+  //   the leading "+"; national numbers (starting with the trunk prefix)
+  //   are folded into international format if the country code is known
+  // - a lookup returns the entry sharing the longest suffix with the
+  //   number (at least minSuffix digits), this matches numbers whose
+  //   country code could not be folded; a suffix shared by entries with
+  //   different texts does not match, since the caller is unknown then
+  // - if there is no such entry, the entry that is the longest prefix of
+  //   the number is returned (eg. the main number of a PABX for an
+  //   extension)
+  // - if several entries have the same number, the one added first wins,
+  //   so phonebooks should be added in order of preference
+
+  class NumberIndex : public RefBase, public NoCopy
+  {
+  private:
+    struct Node
+    {
+      int _child[10];           // index of child node for each digit
+      int _entry;               // entry ending here or -1
+      int _any;                 // some entry in this subtree, -1 if
+                                // none, AMBIGUOUS if the subtree has
+                                // entries with different texts
+      Node();
+    };
+
+    std::string _countryCode;   // country code, eg. "49"
+    std::string _trunkPrefix;   // national trunk prefix, eg. "0"
+    std::string _iddPrefix;     // international prefix, eg. "00"
+    unsigned int _minSuffix;    // minimum length of a suffix match
+    std::vector<Node> _suffixes; // trie of reversed numbers, root is 0
+    std::vector<Node> _prefixes; // trie of numbers, root is 0
+    std::vector<std::string> _texts; // texts of the entries
+
+    static const int AMBIGUOUS = -2;
+
+    // return entry with digits in trie or -1
+    static int lookup(const std::vector<Node> &trie,
+                      const std::string &digits);
+
+    // record that entry is in the subtree of node
+    void setAny(Node &node, int entry) const;
+
+    // insert digits of entry into trie
+    void insert(std::vector<Node> &trie, const std::string &digits,
+                int entry);
+
+  public:
+    // create an empty index
+    // countryCode is the country code of the ME's network (without "+"),
+    // if it is empty national numbers are not folded
+    NumberIndex(std::string countryCode = "", std::string trunkPrefix = "0",
+                std::string iddPrefix = "00",
+                unsigned int minSuffix = DEFAULT_NUMBER_INDEX_MIN_SUFFIX);
+
+    // return normalized form of telephone (see above)
+    std::string normalize(std::string telephone) const;
+
+    // add a single number
+    void add(std::string telephone, std::string text);
+
+    // add all entries of phonebook
+    void add(SortedPhonebookBase &phonebook) throw(GsmException);
+
+    // remove all entries
+    void clear();
+
+    // return number of entries
+    unsigned int size() const {return _texts.size();}
+
+    // look up telephone, return true and set text if found
+    bool find(std::string telephone, std::string &text) const;
+  };
+
+  typedef Ref<NumberIndex> NumberIndexRef;
+};
+
+#endif // GSM_NUMBER_INDEX_H
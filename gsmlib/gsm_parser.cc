@@ -17,27 +17,28 @@
 #include <gsmlib/gsm_nls.h>
 #include <ctype.h>
 #include <assert.h>
-#include <sstream>
+#include <limits.h>
+#include <string.h>
 
 using namespace gsmlib;
 
-// Parser members
+// ParserView members
 
-int Parser::nextChar(bool skipWhiteSpace)
+int ParserView::nextChar(bool skipWhiteSpace)
 {
   if (skipWhiteSpace)
-    while (_i < _s.length() && isspace(_s[_i])) ++_i;
+    while (_p != _end && isspace((unsigned char)*_p)) ++_p;
 
-  if (_i == _s.length())
+  if (_p == _end)
     {
       _eos = true;
       return -1;
     }
 
-  return _s[_i++];
+  return (unsigned char)*_p++;
 }
 
-bool Parser::checkEmptyParameter(bool allowNoParameter) throw(GsmException)
+ParseResult ParserView::checkEmptyParameter(bool allowNoParameter)
 {
   int c = nextChar();
   if (c == ',' || c == -1)
@@ -45,104 +46,180 @@ bool Parser::checkEmptyParameter(bool allowNoParameter) throw(GsmException)
       if (allowNoParameter)
 	{
 	  putBackChar();
-	  return true;
+	  return ParseAbsent;
 	}
       else
-	throwParseException(_("expected parameter"));
-
+	return ParseExpectedParameter;
     }
   putBackChar();
-  return false;
+  return ParseOK;
 }
 
-std::string Parser::parseString2(bool stringWithQuotationMarks)
-  throw(GsmException)
+ParseResult ParserView::parseChar(char c, bool allowNoChar)
+{
+  if (nextChar() != (unsigned char)c)
+    {
+      if (allowNoChar)
+	{
+	  putBackChar();
+	  return ParseAbsent;
+	}
+      else
+	return ParseExpectedChar;
+    }
+  return ParseOK;
+}
+
+ParseResult ParserView::parseComma(bool allowNoComma)
+{
+  ParseResult result = parseChar(',', allowNoComma);
+  return result == ParseExpectedChar ? ParseExpectedComma : result;
+}
+
+ParseResult ParserView::parseInt(int &result, bool allowNoInt)
 {
+  // handle case of empty parameter
+  result = NOT_SET;
+  ParseResult r = checkEmptyParameter(allowNoInt);
+  if (r != ParseOK) return r;
+
   int c;
-  std::string result;
-  if (parseChar('"', true))  // OK, std::string starts and ends with quotation mark
+  int value = 0;
+  bool digits = false;
+  while (isdigit(c = nextChar()))
+    {
+      int digit = c - '0';
+      if (value > (INT_MAX - digit) / 10)
+	return ParseExpectedNumber; // too large
+      value = value * 10 + digit;
+      digits = true;
+    }
+
+  putBackChar();
+  if (! digits)
+    return ParseExpectedNumber;
+
+  result = value;
+  return ParseOK;
+}
+
+ParseResult ParserView::parseString(StringView &result, bool allowNoString,
+				    bool stringWithQuotationMarks)
+{
+  // handle case of empty parameter
+  result = StringView();
+  ParseResult r = checkEmptyParameter(allowNoString);
+  if (r != ParseOK) return r;
+
+  if (parseChar('"', true) == ParseOK) // string starts and ends with '"'
     if (stringWithQuotationMarks)
       {
 	// read till end of line
-	while ((c = nextChar(false)) != -1)
-	  result += c;
-
-	// check for """ at end of line
-	if (result.length() == 0 || result[result.length() - 1]  != '"')
-	  throwParseException(_("expected '\"'"));
-
-	// remove """ at the end
-	result.resize(result.length() - 1);
+	const char *start = _p;
+	_p = _end;
+	_eos = true;
+
+	// check for '"' at end of line and remove it
+	if (_p == start || _p[-1] != '"')
+	  return ParseExpectedQuote;
+	result = StringView(start, _p - 1 - start);
       }
     else
       {
-	// read till next """
-	while ((c = nextChar(false)) != '"')
-	  if (c == -1)
-	    throwParseException();
-	  else
-	    result += c;
+	// read till next '"'
+	const char *quote = (const char*)memchr(_p, '"', _end - _p);
+	if (quote == NULL)
+	  {
+	    _p = _end;
+	    _eos = true;
+	    return ParseUnexpectedEnd;
+	  }
+	result = StringView(_p, quote - _p);
+	_p = quote + 1;
       }
-  else                          // std::string ends with "," or EOL
+  else                          // string ends with "," or EOL
     {
-      c = nextChar(false);
-      while (c != ',' && c != -1)
+      const char *comma = (const char*)memchr(_p, ',', _end - _p);
+      if (comma == NULL)
 	{
-	  result += c;
-	  c = nextChar(false);
+	  result = StringView(_p, _end - _p);
+	  _p = _end;
+	  _eos = true;
+	}
+      else
+	{
+	  result = StringView(_p, comma - _p);
+	  _p = comma;
 	}
-      if (c == ',') putBackChar();
     }
 
-  return result;
+  return ParseOK;
 }
 
-int Parser::parseInt2() throw(GsmException)
+ParseResult ParserView::checkEol()
 {
-  std::string s;
-  int c;
-  int result;
-
-  while (isdigit(c = nextChar())) s += c;
-
-  putBackChar();
-  if (s.length() == 0)
-    throwParseException(_("expected number"));
-
-  std::istringstream is(s.c_str());
-  is >> result;
-  return result;
+  if (nextChar() != -1)
+    {
+      putBackChar();
+      return ParseExpectedEol;
+    }
+  return ParseOK;
 }
 
+// Parser members
+
 void Parser::throwParseException(std::string message) throw(GsmException)
 {
-  std::ostringstream os;
   if (message.length() == 0)
-    throw GsmException(stringPrintf(_("unexpected end of std::string '%s'"),
+    throw GsmException(stringPrintf(_("unexpected end of string '%s'"),
                                     _s.c_str()), ParserError);
   else
     throw GsmException(message +
-                       stringPrintf(_(" (at position %d of std::string '%s')"), _i,
-                                    _s.c_str()), ParserError);
+                       stringPrintf(_(" (at position %d of string '%s')"),
+                                    _view.position(), _s.c_str()),
+                       ParserError);
 }
 
-Parser::Parser(std::string s) : _i(0), _s(s), _eos(false)
+void Parser::check(ParseResult result, char c) throw(GsmException)
+{
+  switch (result)
+    {
+    case ParseOK:
+    case ParseAbsent:
+      break;
+    case ParseUnexpectedEnd:
+      throwParseException();
+      break;
+    case ParseExpectedParameter:
+      throwParseException(_("expected parameter"));
+      break;
+    case ParseExpectedChar:
+      throwParseException(stringPrintf(_("expected '%c'"), c));
+      break;
+    case ParseExpectedComma:
+      throwParseException(_("expected comma"));
+      break;
+    case ParseExpectedNumber:
+      throwParseException(_("expected number"));
+      break;
+    case ParseExpectedQuote:
+      throwParseException(_("expected '\"'"));
+      break;
+    case ParseExpectedEol:
+      throwParseException(_("expected end of line"));
+      break;
+    }
+}
+
+Parser::Parser(std::string s) : _s(s), _view(_s)
 {
 }
 
 bool Parser::parseChar(char c, bool allowNoChar) throw(GsmException)
 {
-  if (nextChar() != c)
-    {
-      if (allowNoChar)
-	{
-	  putBackChar();
-	  return false;
-	}
-      else
-	throwParseException(stringPrintf(_("expected '%c'"), c));
-    }
-  return true;
+  ParseResult result = _view.parseChar(c, allowNoChar);
+  check(result, c);
+  return result == ParseOK;
 }
 
 std::vector<std::string> Parser::parseStringList(bool allowNoList)
@@ -150,16 +227,18 @@ std::vector<std::string> Parser::parseStringList(bool allowNoList)
 {
   // handle case of empty parameter
   std::vector<std::string> result;
-  if (checkEmptyParameter(allowNoList)) return result;
+  ParseResult r = _view.checkEmptyParameter(allowNoList);
+  check(r);
+  if (r == ParseAbsent) return result;
 
   parseChar('(');
-  if (nextChar() != ')')
+  if (_view.nextChar() != ')')
     {
-      putBackChar();
+      _view.putBackChar();
       while (1)
 	{
 	  result.push_back(parseString());
-	  int c = nextChar();
+	  int c = _view.nextChar();
 	  if (c == ')')
 	    break;
 	  if (c == -1)
@@ -172,99 +251,79 @@ std::vector<std::string> Parser::parseStringList(bool allowNoList)
   return result;
 }
 
-std::vector<bool> Parser::parseIntList(bool allowNoList)
-  throw(GsmException)
+IntSet Parser::parseIntSet(bool allowNoList) throw(GsmException)
 {
   // handle case of empty parameter
-  bool isRange = false;
-  std::vector<bool> result;
-  int resultCapacity = 0;
-  unsigned int saveI = _i;
-
-  if (checkEmptyParameter(allowNoList)) return result;
+  IntSet result;
+  ParseResult r = _view.checkEmptyParameter(allowNoList);
+  check(r);
+  if (r == ParseAbsent) return result;
 
   // check for the case of a integer list consisting of only one parameter
   // some TAs omit the parentheses in this case
-  if (isdigit(nextChar()))
+  if (isdigit(_view.nextChar()))
     {
-      putBackChar();
-      int num = parseInt();
-      result.resize(num + 1, false);
-      result[num] = true;
+      _view.putBackChar();
+      result.insert(parseInt());
       return result;
     }
-  putBackChar();
+  _view.putBackChar();
 
-  // run in two passes
-  // pass 0: find capacity needed for result
-  // pass 1: resize result and fill it in
-  for (int pass = 0; pass < 2; ++pass)
+  parseChar('(');
+  if (_view.nextChar() != ')')
     {
-      if (pass == 1)
+      _view.putBackChar();
+      int lastInt = -1;
+      bool isRange = false;
+      while (1)
 	{
-	  _i = saveI;
-	  result.resize(resultCapacity + 1, false);
-	}
+	  int thisInt = parseInt();
 
-      parseChar('(');
-      if (nextChar() != ')')
-	{
-	  putBackChar();
-	  int lastInt = -1;
-	  while (1)
+	  if (isRange)
 	    {
-	      int thisInt = parseInt();
+	      assert(lastInt != -1);
+	      result.insert(lastInt, thisInt);
+	      isRange = false;
+	    }
+	  else
+	    result.insert(thisInt);
+	  lastInt = thisInt;
+
+	  int c = _view.nextChar();
+	  if (c == ')')
+	    break;
+
+	  if (c == -1)
+	    throwParseException();
 
+	  if (c != ',' && c != '-')
+	    throwParseException(_("expected ')', ',' or '-'"));
+
+	  if (c == '-')
+	    {
 	      if (isRange)
-		{
-		  assert(lastInt != -1);
-		  if (lastInt <= thisInt)
-		    for (int i = lastInt; i < thisInt; ++i)
-		      {
-			if (i > resultCapacity)
-			  resultCapacity = i;
-			if (pass == 1)
-			  result[i] = true;
-		      }
-		  else
-		    for (int i = thisInt; i < lastInt; ++i)
-		      {
-			if (i > resultCapacity)
-			  resultCapacity = i;
-			if (pass == 1)
-			  result[i] = true;
-		      }
-		  isRange = false;
-		}
-
-	      if (thisInt > resultCapacity)
-		resultCapacity = thisInt;
-	      if (pass == 1)
-		result[thisInt] = true;
-	      lastInt = thisInt;
-
-	      int c = nextChar();
-	      if (c == ')')
-		break;
-
-	      if (c == -1)
-		throwParseException();
-
-	      if (c != ',' && c != '-')
-		throwParseException(_("expected ')', ',' or '-'"));
-
-	      if (c == ',')
-		isRange = false;
-	      else                      // is '-'
-		if (isRange)
-		  throwParseException(_("range of the form a-b-c not allowed"));
-		else
-		  isRange = true;
+		throwParseException(_("range of the form a-b-c not allowed"));
+	      isRange = true;
 	    }
 	}
     }
-  if (isRange)
-    throwParseException(_("range of the form a- no allowed"));
+  return result;
+}
+
+std::vector<bool> Parser::parseIntList(bool allowNoList)
+  throw(GsmException)
+{
+  // handle case of empty parameter
+  std::vector<bool> result;
+  ParseResult r = _view.checkEmptyParameter(allowNoList);
+  check(r);
+  if (r == ParseAbsent) return result;
+
+  IntSet set = parseIntSet();
+  result.resize(set.empty() ? 1 : set.max() + 1, false);
+  for (unsigned int i = 0; i < set.ranges(); ++i)
+    for (int j = set.range(i)._low; j <= set.range(i)._high; ++j)
+      result[j] = true;
   return result;
 }
 
@@ -273,7 +332,9 @@ std::vector<ParameterRange> Parser::parseParameterRangeList(bool allowNoList)
 {
   // handle case of empty parameter
   std::vector<ParameterRange> result;
-  if (checkEmptyParameter(allowNoList)) return result;
+  ParseResult r = _view.checkEmptyParameter(allowNoList);
+  check(r);
+  if (r == ParseAbsent) return result;
 
   result.push_back(parseParameterRange());
   while (parseComma(true))
@@ -289,7 +350,9 @@ ParameterRange Parser::parseParameterRange(bool allowNoParameterRange)
 {
   // handle case of empty parameter
   ParameterRange result;
-  if (checkEmptyParameter(allowNoParameterRange)) return result;
+  ParseResult r = _view.checkEmptyParameter(allowNoParameterRange);
+  check(r);
+  if (r == ParseAbsent) return result;
 
   parseChar('(');
   result._parameter = parseString();
@@ -305,7 +368,9 @@ IntRange Parser::parseRange(bool allowNoRange, bool allowNonRange)
 {
   // handle case of empty parameter
   IntRange result;
-  if (checkEmptyParameter(allowNoRange)) return result;
+  ParseResult r = _view.checkEmptyParameter(allowNoRange);
+  check(r);
+  if (r == ParseAbsent) return result;
 
   parseChar('(');
   result._low = parseInt();
@@ -319,12 +384,8 @@ IntRange Parser::parseRange(bool allowNoRange, bool allowNonRange)
 
 int Parser::parseInt(bool allowNoInt) throw(GsmException)
 {
-  // handle case of empty parameter
-  int result = NOT_SET;
-  if (checkEmptyParameter(allowNoInt)) return result;
-
-  result = parseInt2();
-
+  int result;
+  check(_view.parseInt(result, allowNoInt));
   return result;
 }
 
@@ -332,28 +393,16 @@ std::string Parser::parseString(bool allowNoString,
 				bool stringWithQuotationMarks)
   throw(GsmException)
 {
-  // handle case of empty parameter
-  std::string result;
-  if (checkEmptyParameter(allowNoString)) return result;
-
-  result = parseString2(stringWithQuotationMarks);
-
-  return result;
+  StringView result;
+  check(_view.parseString(result, allowNoString, stringWithQuotationMarks));
+  return result.str();
 }
 
 bool Parser::parseComma(bool allowNoComma) throw(GsmException)
 {
-  if (nextChar() != ',')
-    {
-      if(allowNoComma)
-	{
-	  putBackChar();
-	  return false;
-	}
-      else
-	throwParseException(_("expected comma"));
-    }
-  return true;
+  ParseResult result = _view.parseComma(allowNoComma);
+  check(result);
+  return result == ParseOK;
 }
 
 std::string Parser::parseEol() throw(GsmException)
@@ -361,28 +410,21 @@ std::string Parser::parseEol() throw(GsmException)
   std::string result;
   int c;
 
-  while ((c = nextChar()) != -1) result += c;
+  while ((c = _view.nextChar()) != -1) result += (char)c;
   return result;
 }
 
 void Parser::checkEol() throw(GsmException)
 {
-  if (nextChar() != -1)
-    {
-      putBackChar();
-      throwParseException(_("expected end of line"));
-    }
+  check(_view.checkEol());
 }
 
 std::string Parser::getEol()
 {
   std::string result;
-  int c;
-  unsigned int saveI = _i;
-  bool saveEos = _eos;
-
-  while ((c = nextChar()) != -1) result += c;
-  _i = saveI;
-  _eos = saveEos;
+  for (std::string::iterator i = _s.begin() + _view.position();
+       i != _s.end(); ++i)
+    if (! isspace((unsigned char)*i))
+      result += *i;
   return result;
 }
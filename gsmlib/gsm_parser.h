@@ -20,36 +20,87 @@
 
 namespace gsmlib
 {
-  class Parser : public RefBase
+  // result codes of ParserView
+  enum ParseResult {ParseOK, ParseAbsent, ParseUnexpectedEnd,
+                    ParseExpectedParameter, ParseExpectedChar,
+                    ParseExpectedComma, ParseExpectedNumber,
+                    ParseExpectedQuote, ParseExpectedEol};
+
+  // The class ParserView parses MA/TA result strings without copying
+  // them and without throwing exceptions
+  // - strings are returned as views into the parsed string
+  // - the parse functions return ParseOK if successful, ParseAbsent if
+  //   an optional element is absent (only if allowed by the caller), or
+  //   an error code; after an error position() points to the offending
+  //   character
+  // - the semantics are the same as those of the corresponding Parser
+  //   member functions
+
+  class ParserView
   {
   private:
-    unsigned int _i;            // index into _s, next character
-    std::string _s;                  // std::string to parse
+    const char *_begin, *_end;  // string to parse
+    const char *_p;             // next character
     bool _eos;                  // true if end-of-string reached in nextChar()
 
+  public:
+    ParserView(StringView s) :
+      _begin(s.data()), _end(s.data() + s.length()), _p(_begin),
+      _eos(false) {}
+
     // return next character or -1 if end of string
     int nextChar(bool skipWhiteSpace = true);
 
     // "puts back" a character
-    void putBackChar() {if (! _eos) --_i;}
+    void putBackChar() {if (! _eos) --_p;}
+
+    // return or set position of next character
+    unsigned int position() const {return _p - _begin;}
+    void setPosition(unsigned int position) {_p = _begin + position;}
+
+    // return entire string
+    StringView string() const {return StringView(_begin, _end - _begin);}
 
     // check for empty parameter (ie. "," or end of string)
     // skips white space
-    // returns true if no parameter
-    // or throw an GsmException if allowNoParameter == false
-    bool checkEmptyParameter(bool allowNoParameter) throw(GsmException);
+    // returns ParseAbsent if no parameter and allowNoParameter == true
+    ParseResult checkEmptyParameter(bool allowNoParameter);
 
-    // parse a std::string (like "string")
-    // throw an exception if not well-formed
-    std::string parseString2(bool stringWithQuotationMarks) throw(GsmException);
+    // parse a character
+    ParseResult parseChar(char c, bool allowNoChar = false);
 
-    // parse a int (like 1234)
-    // throw an exception if not well-formed
-    int parseInt2() throw(GsmException);
+    // parse a single ","
+    ParseResult parseComma(bool allowNoComma = false);
+
+    // parse an integer of the form "1234"
+    // result is NOT_SET if the integer is absent
+    ParseResult parseInt(int &result, bool allowNoInt = false);
+
+    // parse a string of the form ""string"" or an unquoted string
+    // result is empty if the string is absent
+    ParseResult parseString(StringView &result, bool allowNoString = false,
+                            bool stringWithQuotationMarks = false);
+
+    // check that end of line is reached
+    ParseResult checkEol();
+  };
+
+  // The class Parser is a wrapper around ParserView that keeps its own
+  // copy of the string and throws a GsmException (ParserError) on errors
+
+  class Parser : public RefBase, public NoCopy
+  {
+  private:
+    std::string _s;             // string to parse
+    ParserView _view;           // parser for _s
 
     // throw a parser exception
     void throwParseException(std::string message = "") throw(GsmException);
 
+    // throw a parser exception if result is an error
+    // c is the character expected by parseChar()
+    void check(ParseResult result, char c = 0) throw(GsmException);
+
   public:
     Parser(std::string s);
 
@@ -64,9 +115,12 @@ namespace gsmlib
       throw(GsmException);
 
     // parse a list of the form "(12, 14)" or "(1-4, 10)"
-    // the result is returned as a bit vector where for each integer
-    // in the list and/or range(s) a bit is set
+    // the result is returned as a set of ranges
     // the list can be empty (ie. == "") if allowNoList == true
+    IntSet parseIntSet(bool allowNoList = false) throw(GsmException);
+
+    // the same, but the result is returned as a bit vector where for
+    // each integer in the list and/or range(s) a bit is set
     std::vector<bool> parseIntList(bool allowNoList = false)
       throw(GsmException);
 
@@ -19,12 +19,17 @@
 #include <gsmlib/gsm_parser.h>
 #include <gsmlib/gsm_me_ta.h>
 #include <sstream>
+#include <algorithm>
 #include <iostream>
 #include <assert.h>
 #include <ctype.h>
 
 using namespace gsmlib;
 
+// smallest range of slots split in halves by preloading if the number of
+// used entries is not known (see Phonebook::Phonebook())
+static const int MIN_PRELOAD_RANGE = 16;
+
 // PhonebookEntry members
 
 PhonebookEntry::PhonebookEntry(const PhonebookEntryBase &e)
@@ -59,14 +64,17 @@ void PhonebookEntry::set(std::string telephone, std::string text, int index,
         ParameterError);
 
     _myPhonebook->writeEntry(_index, telephone, text);
+    _myPhonebook->cacheEntry(*this, telephone, text);
   }
   else
+  {
     _index = index;
+    _cached = true;
+    _telephone = telephone;
+    _text = text;
+  }
 
   _useIndex = useIndex;
-  _cached = true;
-  _telephone = telephone;
-  _text = text;
   _changed = true;
 }
 
@@ -77,8 +85,9 @@ std::string PhonebookEntry::text() const throw(GsmException)
     assert(_myPhonebook != NULL);
     // these operations are at least "logically const"
     PhonebookEntry *thisEntry = const_cast<PhonebookEntry*>(this);
-    _myPhonebook->readEntry(_index, thisEntry->_telephone, thisEntry->_text);
-    thisEntry->_cached = true;
+    std::string telephone, text;
+    _myPhonebook->readEntry(_index, telephone, text);
+    _myPhonebook->cacheEntry(*thisEntry, telephone, text);
   }
   return _text;
 }
@@ -90,8 +99,9 @@ std::string PhonebookEntry::telephone() const throw(GsmException)
     assert(_myPhonebook != NULL);
     // these operations are at least "logically const"
     PhonebookEntry *thisEntry = const_cast<PhonebookEntry*>(this);
-    _myPhonebook->readEntry(_index, thisEntry->_telephone, thisEntry->_text);
-    thisEntry->_cached = true;
+    std::string telephone, text;
+    _myPhonebook->readEntry(_index, telephone, text);
+    _myPhonebook->cacheEntry(*thisEntry, telephone, text);
   }
   return _telephone;
 }
@@ -232,7 +242,6 @@ void Phonebook::writeEntry(int index, std::string telephone, std::string text)
   {
     std::ostringstream os;
     os << "+CPBW=" << index;
-    os << std::ends;
     s = os.str();
   }
   else
@@ -248,7 +257,6 @@ void Phonebook::writeEntry(int index, std::string telephone, std::string text)
     std::ostringstream os;
     os << "+CPBW=" << index << ",\"" << telephone << "\"," << type
        << ",\"";
-    os << std::ends;
     s = os.str();
     // this cannot be added with ostrstream because the gsmText can
     // contain a zero (GSM default alphabet for '@')
@@ -257,6 +265,43 @@ void Phonebook::writeEntry(int index, std::string telephone, std::string text)
   _at->chat(s);
 }
 
+void Phonebook::cacheEntry(PhonebookEntry &entry, std::string telephone,
+                           std::string text)
+{
+  int position = &entry - _phonebook;
+  if (entry._cached)
+  {
+    unindex(_textIndex, normalizeText(entry._text), position);
+    unindex(_telephoneIndex, normalizeTelephone(entry._telephone), position);
+  }
+  else
+    --_uncached;
+
+  entry._cached = true;
+  entry._telephone = telephone;
+  entry._text = text;
+
+  // empty entries are not indexed
+  std::string key = normalizeText(text);
+  if (key != "")
+    _textIndex.insert(std::make_pair(key, position));
+  key = normalizeTelephone(telephone);
+  if (key != "")
+    _telephoneIndex.insert(std::make_pair(key, position));
+}
+
+void Phonebook::unindex(PhonebookIndex &index, std::string key, int position)
+{
+  std::pair<PhonebookIndex::iterator, PhonebookIndex::iterator> range =
+    index.equal_range(key);
+  for (PhonebookIndex::iterator i = range.first; i != range.second; ++i)
+    if (i->second == position)
+    {
+      index.erase(i);
+      return;
+    }
+}
+
 Phonebook::iterator Phonebook::insertFirstEmpty(std::string telephone, std::string text)
   throw(GsmException)
 {
@@ -292,7 +337,8 @@ Phonebook::iterator Phonebook::insert(const std::string telephone,
 
 Phonebook::Phonebook(std::string phonebookName, Ref<GsmAt> at, MeTa &myMeTa,
                      bool preload) throw(GsmException) :
-  _phonebookName(phonebookName), _at(at), _myMeTa(myMeTa), _useCache(true)
+  _phonebookName(phonebookName), _at(at), _myMeTa(myMeTa), _useCache(true),
+  _uncached(0)
 {
   // select phonebook
   _myMeTa.setPhonebook(_phonebookName);
@@ -313,7 +359,7 @@ Phonebook::Phonebook(std::string phonebookName, Ref<GsmAt> at, MeTa &myMeTa,
   Parser p(_at->chat("+CPBR=?", "+CPBR:"));
 
   // get index of actually available entries in the phonebook
-  std::vector<bool> availablePositions = p.parseIntList();
+  IntSet availablePositions = p.parseIntSet();
   p.parseComma();
   _maxNumberLength = p.parseInt();
   p.parseComma();
@@ -327,89 +373,117 @@ Phonebook::Phonebook(std::string phonebookName, Ref<GsmAt> at, MeTa &myMeTa,
   // In memory we store only phonebook entries that may actually be
   // used, ie. the phonebook in memory is not sparse.
   // Each entry has a member _index that corresponds to the index in the ME.
-  if (_maxSize == -1)
-  {
-    _maxSize = 0;
-    for (std::vector<bool>::iterator i = availablePositions.begin();
-         i != availablePositions.end(); ++i)
-      if (*i) ++_maxSize;
-  }
+  if (_maxSize == -1 || _maxSize > (int)availablePositions.count())
+    _maxSize = availablePositions.count();
 
   // for use with preload below
   int *meToPhonebookIndexMap =
-    (int*)alloca(sizeof(int) * (availablePositions.size() + 1));
+    (int*)alloca(sizeof(int) * (availablePositions.max() + 2));
 
   // initialize phone book entries
   if (_maxSize == 0)
     _phonebook = NULL;
   else
     _phonebook = new PhonebookEntry[_maxSize];
-  int nextAvailableIndex = 0;
-  int i;
-  for (i = 0; i < _maxSize; i++)
-  {
-    while (! availablePositions[nextAvailableIndex])
-      nextAvailableIndex++;
-    _phonebook[i]._index = nextAvailableIndex;
-    _phonebook[i]._cached = false;
-    _phonebook[i]._myPhonebook = this;
-    meToPhonebookIndexMap[nextAvailableIndex++] = i;
-  }
-
-  // find out first index number of phonebook
-  int firstIndex = -1;
-  for (i = 0; i < _maxSize; i++)
-    if (availablePositions[i])
+  int i = 0;
+  for (unsigned int r = 0; r < availablePositions.ranges(); ++r)
+    for (int index = availablePositions.range(r)._low;
+         index <= availablePositions.range(r)._high && i < _maxSize; ++index)
     {
-      firstIndex = i;
-      break;
+      _phonebook[i]._index = index;
+      _phonebook[i]._cached = false;
+      _phonebook[i]._myPhonebook = this;
+      meToPhonebookIndexMap[index] = i++;
     }
+  _uncached = _maxSize;
 
   // preload phonebook
-  // Note: this contains a workaround for the bug that
-  // some MEs can not return the entire phonebook with one AT command
-  // To detect this condition, _size must be known
-  // also, this code only handles non-sparse phonebooks
-  if (preload && _size != -1 && 
-      (int)availablePositions.size() == _maxSize + firstIndex)
+  // The available positions are read in ranges with +CPBR=<first>,<last>.
+  // Note: this contains workarounds for the following bugs:
+  // - some MEs can not return the entire phonebook with one AT command,
+  //   if _size is known and a response lacks entries, the rest of the
+  //   range is requested again
+  // - some MEs return an error for ranges that are too large or do not
+  //   contain entries, such ranges are split in halves; if _size is not
+  //   known, a range that is not larger than one the ME has answered
+  //   before has no entries, and ranges of up to MIN_PRELOAD_RANGE slots
+  //   are not split further
+  // Slots between the entries returned are known to be empty, and so are
+  // all slots of a range answered without any entries. Slots that cannot
+  // be read this way are read later by readEntry().
+  if (preload)
   {
-    int entriesRead = 0;
-    int startIndex = firstIndex;
+    // stack of ranges of ME indices still to read, lowest range on top
+    std::vector<std::pair<int, int> > ranges;
+    int lastIndex = _maxSize == 0 ? -1 : _phonebook[_maxSize - 1]._index;
+    for (int r = availablePositions.ranges() - 1; r >= 0; --r)
+      if (availablePositions.range(r)._low <= lastIndex)
+        ranges.push_back(
+          std::make_pair(availablePositions.range(r)._low,
+                         std::min(availablePositions.range(r)._high,
+                                  lastIndex)));
 
-    while (entriesRead < _size)
+    int entriesRead = 0;
+    int largestRange = 0;       // largest range answered without error
+    bool complete = true;       // true if all slots could be read
+    reportProgress(0, _maxSize); // chatv also calls reportProgress()
+    while (ranges.size() > 0 && (_size == -1 || entriesRead < _size))
     {
-      reportProgress(0, _maxSize); // chatv also calls reportProgress()
-      std::vector<std::string> responses =
-        _at->chatv("+CPBR=" + intToStr(startIndex) +
-                   "," + intToStr(_maxSize + firstIndex - 1),
-                   "+CPBR:", true);
-
-      // this means that we have read nothing even though not all
-      // entries have been retrieved (entriesRead < _size)
-      // this could be due to a malfunction of the ME...
-      // anyway, missing entries can be read later by readEntry()
-      if (responses.size() == 0)
+      int first = ranges.back().first;
+      int last = ranges.back().second;
+      ranges.pop_back();
+
+      std::vector<std::string> responses;
+      try
+      {
+        responses = _at->chatv("+CPBR=" + intToStr(first) + "," +
+                               intToStr(last), "+CPBR:");
+      }
+      catch (GsmException &e)
       {
+        if (e.getErrorClass() != ChatError)
+          throw;
 #ifndef NDEBUG
         if (debugLevel() >= 1)
-	  std::cerr << "*** error when preloading phonebook: "
-		    << "not all entries returned" << std::endl;
+          std::cerr << "*** error when preloading phonebook range "
+                    << first << "-" << last << std::endl;
 #endif
-        break;
+        if (_size == -1 && last - first < largestRange)
+          for (int index = first; index <= last; ++index)
+            cacheEntry(_phonebook[meToPhonebookIndexMap[index]], "", "");
+        else if (first < last &&
+                 (_size != -1 || last - first >= MIN_PRELOAD_RANGE))
+        {
+          int middle = (first + last) / 2;
+          ranges.push_back(std::make_pair(middle + 1, last));
+          ranges.push_back(std::make_pair(first, middle));
+        }
+        else
+          complete = false;
+        continue;
       }
 
+      largestRange = std::max(largestRange, last - first + 1);
+
+      // ME index following the last entry returned
+      int nextIndex = first;
       for (std::vector<std::string>::iterator i = responses.begin();
            i != responses.end(); ++i)
       {
-	std::string telephone, text;
+        std::string telephone, text;
         int meIndex = parsePhonebookEntry(*i, telephone, text);
-        _phonebook[meToPhonebookIndexMap[meIndex]]._cached = true;
-        _phonebook[meToPhonebookIndexMap[meIndex]]._telephone = telephone;
-        _phonebook[meToPhonebookIndexMap[meIndex]]._text = text;
-        assert(_phonebook[meToPhonebookIndexMap[meIndex]]._index == meIndex);
+        if (meIndex < nextIndex || meIndex > last)
+          continue;             // not requested or out of order
+
+        // the slots in between are empty
+        for (; nextIndex < meIndex; ++nextIndex)
+          cacheEntry(_phonebook[meToPhonebookIndexMap[nextIndex]], "", "");
 
+        PhonebookEntry &entry = _phonebook[meToPhonebookIndexMap[meIndex]];
+        assert(entry._index == meIndex);
+        cacheEntry(entry, telephone, text);
+        nextIndex = meIndex + 1;
         ++entriesRead;
-        startIndex = meIndex + 1;
 #ifndef NDEBUG
         if (debugLevel() >= 1)
 	  std::cerr << "*** Preloading PB entry " << meIndex
@@ -417,7 +491,30 @@ Phonebook::Phonebook(std::string phonebookName, Ref<GsmAt> at, MeTa &myMeTa,
 		    << " text " << text << std::endl;
 #endif
       }
+
+      // the slots after the last entry returned are only known to be
+      // empty once all entries have been found (see below), the response
+      // may have been truncated
+      // a response without entries cannot be truncated
+      if (nextIndex <= last && (_size == -1 || entriesRead < _size))
+      {
+        if (nextIndex > first)
+          ranges.push_back(std::make_pair(nextIndex, last));
+        else
+          for (; nextIndex <= last; ++nextIndex)
+            cacheEntry(_phonebook[meToPhonebookIndexMap[nextIndex]], "", "");
+      }
+    }
+
+    // if all entries have been found the remaining slots are empty
+    if (_size != -1 && entriesRead >= _size)
+    {
+      for (i = 0; i < _maxSize; i++)
+        if (! _phonebook[i]._cached)
+          cacheEntry(_phonebook[i], "", "");
     }
+    else if (_size == -1 && complete)
+      _size = entriesRead;
   }
 }
 
@@ -548,6 +645,19 @@ Phonebook::iterator Phonebook::find(std::string text) throw(GsmException)
   int index;
   std::string telephone;
 
+  // look up text in the index of cached entries
+  // the index is case-insensitive, only exact matches are returned
+  if (_useCache)
+  {
+    std::pair<PhonebookIndex::iterator, PhonebookIndex::iterator> range =
+      _textIndex.equal_range(normalizeText(text));
+    for (PhonebookIndex::iterator j = range.first; j != range.second; ++j)
+      if (_phonebook[j->second]._text == text)
+        return begin() + j->second;
+    if (_uncached == 0)
+      return end();
+  }
+
   int i;
   for (i = 0; i < _maxSize; i++)
     if (_phonebook[i].text() == text)
@@ -569,15 +679,51 @@ Phonebook::iterator Phonebook::find(std::string text) throw(GsmException)
 	  }
 	else
 	  {
-	    _phonebook[i]._cached = true;
-	    _phonebook[i]._telephone = telephone;
-	    _phonebook[i]._text = text;
+	    cacheEntry(_phonebook[i], telephone, text);
 	    return begin() + i;
 	  }
       }
   return end();
 }
 
+Phonebook::iterator Phonebook::findTelephone(std::string telephone)
+  throw(GsmException)
+{
+  std::string key = normalizeTelephone(telephone);
+  if (key == "")
+    return end();
+
+  // look up number in the index of cached entries
+  if (_useCache)
+  {
+    PhonebookIndex::iterator j = _telephoneIndex.find(key);
+    if (j != _telephoneIndex.end())
+      return begin() + j->second;
+    if (_uncached == 0)
+      return end();
+  }
+
+  // read the entries not cached yet
+  for (int i = 0; i < _maxSize; i++)
+    if (normalizeTelephone(_phonebook[i].telephone()) == key)
+      return begin() + i;
+  return end();
+}
+
+std::string Phonebook::normalizeText(std::string text)
+{
+  return lowercase(text);
+}
+
+std::string Phonebook::normalizeTelephone(std::string telephone)
+{
+  std::string result;
+  for (std::string::iterator i = telephone.begin(); i != telephone.end(); ++i)
+    if (isdigit(*i) || *i == '*' || *i == '#')
+      result += *i;
+  return result;
+}
+
 Phonebook::~Phonebook()
 {
   delete []_phonebook;
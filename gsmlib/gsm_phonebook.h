@@ -19,6 +19,7 @@
 #include <string>
 #include <iterator>
 #include <vector>
+#include <map>
 
 namespace gsmlib
 {
@@ -86,6 +87,21 @@ namespace gsmlib
     std::vector<int> _positionMap;   // maps in-memory index to ME index
     MeTa &_myMeTa;              // the MeTa object that created this Phonebook
     bool _useCache;             // true if entries should be cached
+    int _uncached;              // number of entries not cached yet
+
+    // indexes of the cached entries, map normalized text or telephone
+    // number to the position in _phonebook
+    typedef std::multimap<std::string, int> PhonebookIndex;
+    PhonebookIndex _textIndex;
+    PhonebookIndex _telephoneIndex;
+
+    // store telephone and text in entry, mark it as cached and
+    // update the indexes
+    void cacheEntry(PhonebookEntry &entry, std::string telephone,
+                    std::string text);
+
+    // remove position from index
+    static void unindex(PhonebookIndex &index, std::string key, int position);
 
     // helper function, parse phonebook response returned by ME/TA
     // returns index of entry
@@ -176,7 +192,20 @@ namespace gsmlib
     void clear() throw(GsmException);
 
     // finds an entry given the text
+    // only an entry with exactly this text is returned
+    // if all entries are cached, this is done without accessing the ME
     iterator find(std::string text) throw(GsmException);
+
+    // finds an entry given the telephone number
+    // numbers are compared after normalization (see below), so
+    // "+49 171 123" matches "49171123"
+    // if all entries are cached, this is done without accessing the ME
+    iterator findTelephone(std::string telephone) throw(GsmException);
+
+    // return normalized text (lower case) and telephone number (only
+    // digits, '*', and '#') as used for the lookups
+    static std::string normalizeText(std::string text);
+    static std::string normalizeTelephone(std::string telephone);
     
     // destructor
     virtual ~Phonebook();
@@ -26,9 +26,19 @@ namespace gsmlib
 
   class Port : public RefBase
   {
+  private:
+    std::string _line;          // line returned by default getLineView()
+
   public:
     // read line from port(including eol characters)
     virtual std::string getLine() throw(GsmException) =0;
+
+    // same as getLine(), but return a view of the line that is only valid
+    // until the next read from the port
+    // ports that buffer received data return a view into their buffer,
+    // the default implementation returns a view of a copy
+    virtual StringView getLineView() throw(GsmException)
+      {_line = getLine(); return _line;}
     
     // write line to port
     virtual void putLine(std::string line,
@@ -0,0 +1,443 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_shared_me_ta.cc
+// *
+// * Purpose: Access to one ME/TA from several threads
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#if !defined(HAVE_CONFIG_H) || defined(HAVE_LIBPTHREAD)
+#include <gsmlib/gsm_nls.h>
+#include <gsmlib/gsm_shared_me_ta.h>
+#include <gsmlib/gsm_at.h>
+#include <sys/time.h>
+#include <errno.h>
+
+using namespace gsmlib;
+
+// interval in which the idle I/O thread polls for unsolicited result codes
+static const long pollInterval = 100000; // usecs
+
+// Transaction members
+
+Transaction::Transaction(TransactionPriority priority) :
+  _priority(priority), _done(false), _exception(NULL)
+{
+  pthread_mutex_init(&_mtx, NULL);
+  pthread_cond_init(&_cond, NULL);
+}
+
+bool Transaction::execute(MeTa &meTa)
+{
+  try
+  {
+    if (run(meTa))
+      return true;
+  }
+  catch (GsmException &e)
+  {
+    fail(e);
+    return false;
+  }
+  pthread_mutex_lock(&_mtx);
+  _done = true;
+  pthread_cond_broadcast(&_cond);
+  pthread_mutex_unlock(&_mtx);
+  return false;
+}
+
+void Transaction::fail(const GsmException &e)
+{
+  pthread_mutex_lock(&_mtx);
+  _exception = new GsmException(e);
+  _done = true;
+  pthread_cond_broadcast(&_cond);
+  pthread_mutex_unlock(&_mtx);
+}
+
+bool Transaction::done()
+{
+  pthread_mutex_lock(&_mtx);
+  bool result = _done;
+  pthread_mutex_unlock(&_mtx);
+  return result;
+}
+
+void Transaction::wait() throw(GsmException)
+{
+  pthread_mutex_lock(&_mtx);
+  while (! _done)
+    pthread_cond_wait(&_cond, &_mtx);
+  pthread_mutex_unlock(&_mtx);
+  if (_exception != NULL)
+    throw *_exception;
+}
+
+Transaction::~Transaction()
+{
+  delete _exception;
+  pthread_cond_destroy(&_cond);
+  pthread_mutex_destroy(&_mtx);
+}
+
+// ChatTransaction members
+
+ChatTransaction::ChatTransaction(std::string atCommand, std::string response,
+                                 bool ignoreErrors, bool acceptEmptyResponse,
+                                 TransactionPriority priority) :
+  Transaction(priority), _atCommand(atCommand), _response(response),
+  _ignoreErrors(ignoreErrors), _acceptEmptyResponse(acceptEmptyResponse)
+{
+}
+
+bool ChatTransaction::run(MeTa &meTa) throw(GsmException)
+{
+  _result = meTa.getAt()->chat(_atCommand, _response, _ignoreErrors,
+                               _acceptEmptyResponse);
+  return false;
+}
+
+// ChatvTransaction members
+
+ChatvTransaction::ChatvTransaction(std::string atCommand, std::string response,
+                                   bool ignoreErrors,
+                                   TransactionPriority priority) :
+  Transaction(priority), _atCommand(atCommand), _response(response),
+  _ignoreErrors(ignoreErrors)
+{
+}
+
+bool ChatvTransaction::run(MeTa &meTa) throw(GsmException)
+{
+  _result = meTa.getAt()->chatv(_atCommand, _response, _ignoreErrors);
+  return false;
+}
+
+// SMSBatchTransaction members
+
+SMSBatchTransaction::SMSBatchTransaction(
+  const std::vector<Ref<SMSSubmitMessage> > &messages,
+  TransactionPriority priority) :
+  Transaction(priority), _messages(messages), _sent(0)
+{
+}
+
+bool SMSBatchTransaction::run(MeTa &meTa) throw(GsmException)
+{
+  if (_sent < _messages.size())
+  {
+    meTa.sendSMS(_messages[_sent]);
+    ++_sent;
+  }
+  return _sent < _messages.size();
+}
+
+unsigned int SMSBatchTransaction::sent()
+{
+  try
+  {
+    wait();
+  }
+  catch (GsmException &e)
+  {
+  }
+  return _sent;
+}
+
+// SharedMeTa::EventQueue members
+
+void SharedMeTa::EventQueue::callerLineID(std::string number,
+                                          std::string subAddr,
+                                          std::string alpha)
+{
+  Event event;
+  event._type = Event::CallerLineID;
+  event._number = number;
+  event._subAddr = subAddr;
+  event._alpha = alpha;
+  _sharedMeTa.postEvent(event);
+}
+
+void SharedMeTa::EventQueue::noAnswer()
+{
+  Event event;
+  event._type = Event::NoAnswer;
+  _sharedMeTa.postEvent(event);
+}
+
+void SharedMeTa::EventQueue::SMSReception(SMSMessageRef newMessage,
+                                          SMSMessageType messageType)
+{
+  Event event;
+  event._type = Event::SMSReception;
+  event._sms = newMessage;
+  event._messageType = messageType;
+  _sharedMeTa.postEvent(event);
+}
+
+void SharedMeTa::EventQueue::CBReception(CBMessageRef newMessage)
+{
+  Event event;
+  event._type = Event::CBReception;
+  event._cbm = newMessage;
+  _sharedMeTa.postEvent(event);
+}
+
+void SharedMeTa::EventQueue::SMSReceptionIndication(std::string storeName,
+                                                    unsigned int index,
+                                                    SMSMessageType messageType)
+{
+  Event event;
+  event._type = Event::SMSReceptionIndication;
+  event._storeName = storeName;
+  event._index = index;
+  event._messageType = messageType;
+  _sharedMeTa.postEvent(event);
+}
+
+void SharedMeTa::EventQueue::ringIndication()
+{
+  Event event;
+  event._type = Event::RingIndication;
+  _sharedMeTa.postEvent(event);
+}
+
+// SharedMeTa members
+
+void SharedMeTa::postEvent(const Event &event)
+{
+  pthread_mutex_lock(&_mtx);
+  _events.push_back(event);
+  pthread_cond_signal(&_eventCond);
+  pthread_mutex_unlock(&_mtx);
+}
+
+void SharedMeTa::pollEvents()
+{
+  try
+  {
+    struct timeval noWait = {0, 0};
+    _meTa->waitEvent(&noWait);
+  }
+  catch (GsmException &e)
+  {
+    // ignore, a broken connection is reported to the next transaction
+  }
+}
+
+TransactionRef SharedMeTa::nextTransaction()
+{
+  TransactionRef result;
+  for (int i = 0; i < NumberOfPriorities; ++i)
+    if (! _transactions[i].empty())
+    {
+      result.swap(_transactions[i].front());
+      _transactions[i].pop_front();
+      break;
+    }
+  return result;
+}
+
+void SharedMeTa::ioLoop()
+{
+  pthread_mutex_lock(&_mtx);
+  while (! _stop)
+  {
+    TransactionRef transaction = nextTransaction();
+    if (transaction.isnull())
+    {
+      // wait for a transaction, but poll for unsolicited result codes
+      // regularly
+      struct timeval now;
+      gettimeofday(&now, NULL);
+      long usecs = now.tv_usec + pollInterval;
+      struct timespec deadline;
+      deadline.tv_sec = now.tv_sec + usecs / 1000000;
+      deadline.tv_nsec = (usecs % 1000000) * 1000;
+      if (pthread_cond_timedwait(&_transactionCond, &_mtx, &deadline) ==
+          ETIMEDOUT && ! _stop)
+      {
+        pthread_mutex_unlock(&_mtx);
+        pollEvents();
+        pthread_mutex_lock(&_mtx);
+      }
+    }
+    else
+    {
+      // unsolicited result codes first, then the transaction (step)
+      pthread_mutex_unlock(&_mtx);
+      pollEvents();
+      bool moreSteps = transaction->execute(_meTa());
+      pthread_mutex_lock(&_mtx);
+
+      // continue with the next step unless there are transactions of
+      // higher priority
+      if (moreSteps)
+        _transactions[transaction->priority()].push_front(transaction);
+    }
+  }
+
+  // fail transactions that are still queued
+  TransactionRef transaction;
+  while (! (transaction = nextTransaction()).isnull())
+    transaction->fail(
+      GsmException(_("shared ME/TA access stopped"), OtherError));
+  _ioDone = true;
+  pthread_cond_signal(&_eventCond);
+  pthread_mutex_unlock(&_mtx);
+}
+
+void SharedMeTa::eventLoop()
+{
+  pthread_mutex_lock(&_mtx);
+  while (1)
+  {
+    while (_events.empty() && ! _ioDone)
+      pthread_cond_wait(&_eventCond, &_mtx);
+    if (_events.empty())
+      break;
+
+    Event event = _events.front();
+    _events.pop_front();
+    GsmEvent *handler = _eventHandler;
+    pthread_mutex_unlock(&_mtx);
+
+    if (handler != NULL)
+      try
+      {
+        switch (event._type)
+        {
+        case Event::CallerLineID:
+          handler->callerLineID(event._number, event._subAddr, event._alpha);
+          break;
+        case Event::NoAnswer:
+          handler->noAnswer();
+          break;
+        case Event::SMSReception:
+          handler->SMSReception(event._sms, event._messageType);
+          break;
+        case Event::CBReception:
+          handler->CBReception(event._cbm);
+          break;
+        case Event::SMSReceptionIndication:
+          handler->SMSReceptionIndication(event._storeName, event._index,
+                                          event._messageType);
+          break;
+        case Event::RingIndication:
+          handler->ringIndication();
+          break;
+        }
+      }
+      catch (GsmException &e)
+      {
+        // the handler's errors cannot be reported to anybody
+      }
+
+    pthread_mutex_lock(&_mtx);
+  }
+  pthread_mutex_unlock(&_mtx);
+}
+
+void *SharedMeTa::ioThread(void *sharedMeTa)
+{
+  ((SharedMeTa*)sharedMeTa)->ioLoop();
+  return NULL;
+}
+
+void *SharedMeTa::eventThread(void *sharedMeTa)
+{
+  ((SharedMeTa*)sharedMeTa)->eventLoop();
+  return NULL;
+}
+
+SharedMeTa::SharedMeTa(Ref<Port> port) throw(GsmException) :
+  _meTa(new MeTa(port)), _eventQueue(*this), _eventHandler(NULL),
+  _stop(false), _ioDone(false)
+{
+  _meTa->setEventHandler(&_eventQueue);
+  pthread_mutex_init(&_mtx, NULL);
+  pthread_cond_init(&_transactionCond, NULL);
+  pthread_cond_init(&_eventCond, NULL);
+
+  if (pthread_create(&_eventThread, NULL, eventThread, this) != 0)
+    throw GsmException(_("cannot create thread"), OSError);
+  if (pthread_create(&_ioThread, NULL, ioThread, this) != 0)
+  {
+    pthread_mutex_lock(&_mtx);
+    _ioDone = true;
+    pthread_cond_signal(&_eventCond);
+    pthread_mutex_unlock(&_mtx);
+    pthread_join(_eventThread, NULL);
+    throw GsmException(_("cannot create thread"), OSError);
+  }
+}
+
+void SharedMeTa::submit(const TransactionRef &transaction)
+{
+  pthread_mutex_lock(&_mtx);
+  if (_stop)
+  {
+    pthread_mutex_unlock(&_mtx);
+    transaction->fail(
+      GsmException(_("shared ME/TA access stopped"), OtherError));
+    return;
+  }
+  _transactions[transaction->priority()].push_back(transaction);
+  pthread_cond_signal(&_transactionCond);
+  pthread_mutex_unlock(&_mtx);
+}
+
+ChatTransactionRef SharedMeTa::chat(std::string atCommand,
+                                    std::string response,
+                                    bool ignoreErrors,
+                                    bool acceptEmptyResponse,
+                                    TransactionPriority priority)
+{
+  ChatTransactionRef result =
+    new ChatTransaction(atCommand, response, ignoreErrors,
+                        acceptEmptyResponse, priority);
+  submit(result.getptr());
+  return result;
+}
+
+ChatvTransactionRef SharedMeTa::chatv(std::string atCommand,
+                                      std::string response,
+                                      bool ignoreErrors,
+                                      TransactionPriority priority)
+{
+  ChatvTransactionRef result =
+    new ChatvTransaction(atCommand, response, ignoreErrors, priority);
+  submit(result.getptr());
+  return result;
+}
+
+GsmEvent *SharedMeTa::setEventHandler(GsmEvent *newHandler)
+{
+  pthread_mutex_lock(&_mtx);
+  GsmEvent *result = _eventHandler;
+  _eventHandler = newHandler;
+  pthread_mutex_unlock(&_mtx);
+  return result;
+}
+
+SharedMeTa::~SharedMeTa()
+{
+  pthread_mutex_lock(&_mtx);
+  _stop = true;
+  pthread_cond_signal(&_transactionCond);
+  pthread_mutex_unlock(&_mtx);
+  pthread_join(_ioThread, NULL);
+  pthread_join(_eventThread, NULL);
+
+  _meTa->setEventHandler(NULL);
+  pthread_cond_destroy(&_eventCond);
+  pthread_cond_destroy(&_transactionCond);
+  pthread_mutex_destroy(&_mtx);
+}
+
+#endif // HAVE_LIBPTHREAD
@@ -0,0 +1,262 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_shared_me_ta.h
+// *
+// * Purpose: Access to one ME/TA from several threads
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef GSM_SHARED_ME_TA_H
+#define GSM_SHARED_ME_TA_H
+
+#include <gsmlib/gsm_me_ta.h>
+#include <gsmlib/gsm_event.h>
+#include <gsmlib/gsm_util.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <pthread.h>
+
+namespace gsmlib
+{
+  // priority classes of transactions
+  // unsolicited result codes are always handled before any transaction
+  enum TransactionPriority {InteractivePriority, BulkPriority,
+                            NumberOfPriorities};
+
+  // An AT transaction, ie. a sequence of MeTa or GsmAt calls that must
+  // not be interleaved with the AT traffic of other threads
+  // - transactions are executed by the I/O thread of a SharedMeTa
+  // - the submitting thread waits for the result with wait(), so the
+  //   transaction is also the "future" of its result
+  // - derived classes implement run() and store their result
+  // - long transactions should perform their work in steps, transactions
+  //   of higher priority are executed between the steps
+
+  class Transaction : public RefBase, public NoCopy
+  {
+  private:
+    TransactionPriority _priority;
+    pthread_mutex_t _mtx;
+    pthread_cond_t _cond;       // signalled when the transaction is done
+    bool _done;
+    GsmException *_exception;   // exception thrown by run() or NULL
+
+    // run the next step of the transaction, return true if there are more
+    // steps, otherwise store exception and signal waiting threads
+    bool execute(MeTa &meTa);
+
+    // complete the transaction with an error without running it
+    void fail(const GsmException &e);
+
+  protected:
+    // perform the transaction (or its next step), called by the I/O thread
+    // return true if run() must be called again for the next step
+    virtual bool run(MeTa &meTa) throw(GsmException) =0;
+
+  public:
+    Transaction(TransactionPriority priority = InteractivePriority);
+
+    // return priority class
+    TransactionPriority priority() const {return _priority;}
+
+    // return true if the transaction has been executed
+    bool done();
+
+    // wait until the transaction has been executed
+    // the exception thrown by run() (if any) is thrown again here
+    void wait() throw(GsmException);
+
+    virtual ~Transaction();
+
+    friend class SharedMeTa;
+  };
+
+  typedef Ref<Transaction> TransactionRef;
+
+  // transaction that performs one GsmAt::chat()
+
+  class ChatTransaction : public Transaction
+  {
+  private:
+    std::string _atCommand;
+    std::string _response;
+    bool _ignoreErrors;
+    bool _acceptEmptyResponse;
+    std::string _result;
+
+  protected:
+    bool run(MeTa &meTa) throw(GsmException);
+
+  public:
+    ChatTransaction(std::string atCommand, std::string response = "",
+                    bool ignoreErrors = false,
+                    bool acceptEmptyResponse = false,
+                    TransactionPriority priority = InteractivePriority);
+
+    // wait for the transaction and return the result of chat()
+    std::string result() throw(GsmException) {wait(); return _result;}
+  };
+
+  typedef Ref<ChatTransaction> ChatTransactionRef;
+
+  // transaction that performs one GsmAt::chatv()
+
+  class ChatvTransaction : public Transaction
+  {
+  private:
+    std::string _atCommand;
+    std::string _response;
+    bool _ignoreErrors;
+    std::vector<std::string> _result;
+
+  protected:
+    bool run(MeTa &meTa) throw(GsmException);
+
+  public:
+    ChatvTransaction(std::string atCommand, std::string response = "",
+                     bool ignoreErrors = false,
+                     TransactionPriority priority = InteractivePriority);
+
+    // wait for the transaction and return the result of chatv()
+    std::vector<std::string> result() throw(GsmException)
+      {wait(); return _result;}
+  };
+
+  typedef Ref<ChatvTransaction> ChatvTransactionRef;
+
+  // transaction that sends several SMSs, one per step
+
+  class SMSBatchTransaction : public Transaction
+  {
+  private:
+    std::vector<Ref<SMSSubmitMessage> > _messages;
+    unsigned int _sent;
+
+  protected:
+    bool run(MeTa &meTa) throw(GsmException);
+
+  public:
+    SMSBatchTransaction(const std::vector<Ref<SMSSubmitMessage> > &messages,
+                        TransactionPriority priority = BulkPriority);
+
+    // wait for the transaction and return the number of SMSs sent
+    // does not throw, use wait() to get the error if not all were sent
+    unsigned int sent();
+  };
+
+  typedef Ref<SMSBatchTransaction> SMSBatchTransactionRef;
+
+  // The class SharedMeTa lets several threads use one ME/TA
+  // - it owns the MeTa object and an I/O thread that executes the queued
+  //   transactions one after another, those of the highest priority class
+  //   first and in submission order within a class
+  // - before each transaction (step) and while no transaction is queued,
+  //   the I/O thread polls the ME/TA for unsolicited result codes
+  // - unsolicited result codes (also those arriving in the middle of a
+  //   transaction) are passed to the event handler in a separate event
+  //   thread, so that handlers may submit transactions themselves
+  // - all member functions may be called from any thread
+  // - only available if gsmlib was configured with POSIX threads
+  //   (HAVE_LIBPTHREAD)
+
+  class SharedMeTa : public RefBase, public NoCopy
+  {
+  private:
+    // an unsolicited result code waiting for the event thread
+    struct Event
+    {
+      enum Type {CallerLineID, NoAnswer, SMSReception, CBReception,
+                 SMSReceptionIndication, RingIndication};
+      Type _type;
+      std::string _number, _subAddr, _alpha; // CallerLineID
+      SMSMessageRef _sms;       // SMSReception
+      CBMessageRef _cbm;        // CBReception
+      std::string _storeName;   // SMSReceptionIndication
+      unsigned int _index;      // SMSReceptionIndication
+      GsmEvent::SMSMessageType _messageType;
+    };
+
+    // event handler of the MeTa that queues the events
+    class EventQueue : public GsmEvent
+    {
+    private:
+      SharedMeTa &_sharedMeTa;
+
+    public:
+      EventQueue(SharedMeTa &sharedMeTa) : _sharedMeTa(sharedMeTa) {}
+
+      void callerLineID(std::string number, std::string subAddr,
+                        std::string alpha);
+      void noAnswer();
+      void SMSReception(SMSMessageRef newMessage,
+                        SMSMessageType messageType);
+      void CBReception(CBMessageRef newMessage);
+      void SMSReceptionIndication(std::string storeName, unsigned int index,
+                                  SMSMessageType messageType);
+      void ringIndication();
+    };
+
+    Ref<MeTa> _meTa;            // only used by the I/O thread
+    EventQueue _eventQueue;
+    GsmEvent *_eventHandler;    // handler called by the event thread
+    pthread_mutex_t _mtx;       // protects all members below
+    pthread_cond_t _transactionCond; // signalled if transaction queued
+    pthread_cond_t _eventCond;  // signalled if event queued
+    std::deque<TransactionRef> _transactions[NumberOfPriorities];
+    std::deque<Event> _events;
+    bool _stop;                 // true if the I/O thread should terminate
+    bool _ioDone;               // true if the I/O thread has terminated
+    pthread_t _ioThread;
+    pthread_t _eventThread;
+
+    // queue event for the event thread
+    void postEvent(const Event &event);
+
+    // handle unsolicited result codes that are already available
+    void pollEvents();
+
+    // return next transaction or empty Ref if none queued
+    TransactionRef nextTransaction();
+
+    // thread functions
+    void ioLoop();
+    void eventLoop();
+    static void *ioThread(void *sharedMeTa);
+    static void *eventThread(void *sharedMeTa);
+
+  public:
+    // initialize the ME/TA on port (in the calling thread) and start the
+    // I/O and event threads
+    SharedMeTa(Ref<Port> port) throw(GsmException);
+
+    // queue transaction for execution
+    void submit(const TransactionRef &transaction);
+
+    // queue chat() or chatv(), wait for the result using the
+    // returned transaction
+    ChatTransactionRef chat(std::string atCommand, std::string response = "",
+                            bool ignoreErrors = false,
+                            bool acceptEmptyResponse = false,
+                            TransactionPriority priority =
+                            InteractivePriority);
+    ChatvTransactionRef chatv(std::string atCommand,
+                              std::string response = "",
+                              bool ignoreErrors = false,
+                              TransactionPriority priority =
+                              InteractivePriority);
+
+    // set event handler class, return old one
+    // the handler is called by the event thread
+    GsmEvent *setEventHandler(GsmEvent *newHandler);
+
+    // stop the threads, queued transactions fail with an exception
+    virtual ~SharedMeTa();
+  };
+
+  typedef Ref<SharedMeTa> SharedMeTaRef;
+};
+
+#endif // GSM_SHARED_ME_TA_H
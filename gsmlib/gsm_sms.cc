@@ -292,8 +292,7 @@ std::string SMSDeliverMessage::toString() const
                  ((std::string)_userDataHeader).length())
      << std::endl
      << _("User data: '") << _userData << "'" << std::endl
-     << dashes << std::endl << std::endl
-     << std::ends;
+     << dashes << std::endl << std::endl;
   return os.str();
 }
 
@@ -448,8 +447,7 @@ std::string SMSSubmitMessage::toString() const
                                               _userDataHeader.length())
      << std::endl
      << _("User data: '") << _userData << "'" << std::endl
-     << dashes << std::endl << std::endl
-     << std::ends;
+     << dashes << std::endl << std::endl;
   return os.str();
 }
 
@@ -523,8 +521,7 @@ std::string SMSStatusReportMessage::toString() const
      << _("Discharge time: ") << _dischargeTime.toString() << std::endl
      << _("Status: 0x") << std::hex << (unsigned int)_status << std::dec
      << " '" << getSMSStatusString(_status) << "'" << std::endl
-     << dashes << std::endl << std::endl
-     << std::ends;
+     << dashes << std::endl << std::endl;
   return os.str(); 
 }
 
@@ -610,8 +607,7 @@ std::string SMSCommandMessage::toString() const
      << "'" << std::endl
      << _("Command data length: ") << (unsigned int)_commandDataLength << std::endl
      << _("Command data: '") << _commandData << "'" << std::endl
-     << dashes << std::endl << std::endl
-     << std::ends;
+     << dashes << std::endl << std::endl;
   return os.str();
 }
 
@@ -714,8 +710,7 @@ std::string SMSDeliverReportMessage::toString() const
   if (_userDataLengthPresent)
     os << _("User data length: ") << (int)userDataLength() << std::endl
        << _("User data: '") << _userData << "'" << std::endl;
-  os << dashes << std::endl << std::endl
-     << std::ends;
+  os << dashes << std::endl << std::endl;
   return os.str();
 }
 
@@ -818,8 +813,7 @@ std::string SMSSubmitReportMessage::toString() const
   if (_userDataLengthPresent)
     os << _("User data length: ") << (int)userDataLength() << std::endl
        << _("User data: '") << _userData << "'" << std::endl;
-  os << dashes << std::endl << std::endl
-     << std::ends;
+  os << dashes << std::endl << std::endl;
   return os.str();
 }
 
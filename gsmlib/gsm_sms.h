@@ -106,7 +106,7 @@ namespace gsmlib
       {_dataCodingScheme = x;}
 
     void setServiceCentreAddress(Address &x) {_serviceCentreAddress = x;}
-    void setAt(Ref<GsmAt> at) {_at = at;}
+    void setAt(const Ref<GsmAt> &at) {_at = at;}
 
     virtual ~SMSMessage();
 
@@ -0,0 +1,518 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_sms_archive.cc
+// *
+// * Purpose: Block-compressed archive files for SMS messages
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_nls.h>
+#include <gsmlib/gsm_sysdep.h>
+#include <gsmlib/gsm_sms_archive.h>
+#include <cstring>
+
+using namespace gsmlib;
+
+// SMS archive file format:
+// "GSMA" followed by the version number of the file format, unsigned
+// short int, 2 bytes in network byte order
+// then come the blocks:
+// 1. size of the uncompressed block data: 4 bytes in network byte order
+// 2. size of the compressed block data: 4 bytes in network byte order
+// 3. number of messages in the block: 4 bytes in network byte order
+// 4. smallest and largest service centre timestamp in the block,
+//    each 6 bytes (year, month, day, hour, minute, seconds)
+// 5. smallest and largest address in the block, each consisting of
+//    type (1 byte), numbering plan (1 byte), length of number (1 byte)
+//    and number
+// 6. CRC-32 checksum of items 1. to 5.: 4 bytes in network byte order
+// 7. CRC-32 checksum of the compressed block data: 4 bytes in network
+//    byte order
+// 8. compressed block data (LZ4 block format)
+// the uncompressed block data is a sequence of messages:
+// 1. length of PDU in bytes: 2 bytes in network byte order
+// 2. MessageType (1 byte), see gsm_sorted_sms_store.cc
+// 3. PDU
+
+static const char SMS_ARCHIVE_MAGIC[] = "GSMA";
+static const unsigned short int SMS_ARCHIVE_FILE_FORMAT_VERSION = 1;
+
+// size of items 1. to 4. of the block header
+static const unsigned int BLOCK_HEADER_SIZE = 24;
+
+// size of the message header in the uncompressed block data
+static const unsigned int MESSAGE_HEADER_SIZE = 3;
+
+// aux functions to encode and decode integers in network byte order
+
+static void putUnsignedShort(std::string &s, unsigned int value)
+{
+  s += (char)((value >> 8) & 0xff);
+  s += (char)(value & 0xff);
+}
+
+static void putUnsignedLong(std::string &s, unsigned long value)
+{
+  putUnsignedShort(s, (value >> 16) & 0xffff);
+  putUnsignedShort(s, value & 0xffff);
+}
+
+static unsigned int getUnsignedShort(const char *buf)
+{
+  return ((unsigned char)buf[0] << 8) | (unsigned char)buf[1];
+}
+
+static unsigned long getUnsignedLong(const char *buf)
+{
+  return ((unsigned long)getUnsignedShort(buf) << 16) |
+    getUnsignedShort(buf + 2);
+}
+
+// aux functions to encode and decode block summaries
+
+static void putTimestamp(std::string &s, const Timestamp &t)
+{
+  s += (char)t._year;
+  s += (char)t._month;
+  s += (char)t._day;
+  s += (char)t._hour;
+  s += (char)t._minute;
+  s += (char)t._seconds;
+}
+
+static Timestamp getTimestamp(const char *buf)
+{
+  Timestamp result;
+  result._year = (unsigned char)buf[0];
+  result._month = (unsigned char)buf[1];
+  result._day = (unsigned char)buf[2];
+  result._hour = (unsigned char)buf[3];
+  result._minute = (unsigned char)buf[4];
+  result._seconds = (unsigned char)buf[5];
+  return result;
+}
+
+static void putAddress(std::string &s, const Address &a)
+{
+  std::string number = a._number.substr(0, 255);
+  s += (char)a._type;
+  s += (char)a._plan;
+  s += (char)number.length();
+  s += number;
+}
+
+// return items 1. to 5. of the header of block
+static std::string encodeBlockHeader(const SMSArchiveBlock &block)
+{
+  std::string header;
+  putUnsignedLong(header, block._size);
+  putUnsignedLong(header, block._compressedSize);
+  putUnsignedLong(header, block._messages);
+  putTimestamp(header, block._minTimestamp);
+  putTimestamp(header, block._maxTimestamp);
+  putAddress(header, block._minAddress);
+  putAddress(header, block._maxAddress);
+  return header;
+}
+
+// aux function read bytes with error handling
+static void readnbytes(const std::string &filename, std::istream &is,
+                       int len, char *buf) throw(GsmException)
+{
+  is.read(buf, len);
+  if (is.bad() || is.eof())
+    throw GsmException(stringPrintf(_("error reading from file '%s'"),
+                                    filename.c_str()), OSError);
+}
+
+static Address readAddress(const std::string &filename, std::istream &is)
+  throw(GsmException)
+{
+  char buf[255];
+  readnbytes(filename, is, 3, buf);
+  Address result;
+  result._type = (Address::Type)(unsigned char)buf[0];
+  result._plan = (Address::NumberingPlan)(unsigned char)buf[1];
+  unsigned int len = (unsigned char)buf[2];
+  readnbytes(filename, is, len, buf);
+  result._number = std::string(buf, len);
+  return result;
+}
+
+// compression of blocks
+// this is a simple implementation of the LZ4 block format: a sequence of
+// literal runs and back references with offsets of up to 64 KB
+
+static const unsigned int LZ4_MIN_MATCH = 4;
+static const unsigned int LZ4_LAST_LITERALS = 5; // last bytes always literals
+static const unsigned int LZ4_MATCH_LIMIT = 12; // no match starts after this
+static const unsigned int LZ4_MAX_OFFSET = 65535;
+static const unsigned int LZ4_HASH_BITS = 12;
+
+// aux function to write an LZ4 length extension
+static void putLength(std::string &dest, unsigned int len)
+{
+  for (; len >= 255; len -= 255)
+    dest += (char)255;
+  dest += (char)len;
+}
+
+// aux function to write one sequence (literals followed by a match)
+static void putSequence(std::string &dest, const char *literals,
+                        unsigned int literalLen, unsigned int offset,
+                        unsigned int matchLen)
+{
+  unsigned int matchCode = matchLen == 0 ? 0 : matchLen - LZ4_MIN_MATCH;
+  dest += (char)(((literalLen < 15 ? literalLen : 15) << 4) |
+                 (matchCode < 15 ? matchCode : 15));
+  if (literalLen >= 15)
+    putLength(dest, literalLen - 15);
+  dest.append(literals, literalLen);
+  if (matchLen == 0)            // last sequence
+    return;
+  dest += (char)(offset & 0xff);
+  dest += (char)(offset >> 8);
+  if (matchCode >= 15)
+    putLength(dest, matchCode - 15);
+}
+
+static std::string compress(const std::string &source)
+{
+  const char *src = source.data();
+  unsigned int len = source.length();
+  std::string result;
+  result.reserve(len + len / 255 + 16);
+
+  int hashTable[1 << LZ4_HASH_BITS];
+  for (unsigned int h = 0; h < (1 << LZ4_HASH_BITS); ++h)
+    hashTable[h] = -1;
+
+  unsigned int anchor = 0;
+  unsigned int pos = 0;
+  while (len >= LZ4_MATCH_LIMIT && pos <= len - LZ4_MATCH_LIMIT)
+  {
+    unsigned_int_4 sequence;
+    memcpy(&sequence, src + pos, 4);
+    unsigned int hash =
+      ((sequence * 2654435761UL) & 0xffffffffUL) >> (32 - LZ4_HASH_BITS);
+    int candidate = hashTable[hash];
+    hashTable[hash] = pos;
+
+    if (candidate >= 0 && pos - candidate <= LZ4_MAX_OFFSET &&
+        memcmp(src + candidate, src + pos, LZ4_MIN_MATCH) == 0)
+    {
+      unsigned int matchLen = LZ4_MIN_MATCH;
+      while (pos + matchLen < len - LZ4_LAST_LITERALS &&
+             src[candidate + matchLen] == src[pos + matchLen])
+        ++matchLen;
+      putSequence(result, src + anchor, pos - anchor, pos - candidate,
+                  matchLen);
+      pos += matchLen;
+      anchor = pos;
+    }
+    else
+      ++pos;
+  }
+  putSequence(result, src + anchor, len - anchor, 0, 0);
+  return result;
+}
+
+// return false if source is not valid or does not decompress to size bytes
+static bool decompress(const std::string &source, unsigned long size,
+                       std::string &result)
+{
+  const unsigned char *src = (const unsigned char*)source.data();
+  const unsigned char *end = src + source.length();
+  result.resize(size);
+  unsigned long pos = 0;
+
+  while (src < end)
+  {
+    unsigned int token = *src++;
+
+    // copy literals
+    unsigned long literalLen = token >> 4;
+    if (literalLen == 15)
+      do
+      {
+        if (src == end) return false;
+        literalLen += *src;
+      }
+      while (*src++ == 255);
+    if ((unsigned long)(end - src) < literalLen || size - pos < literalLen)
+      return false;
+    result.replace(pos, literalLen, (const char*)src, literalLen);
+    src += literalLen;
+    pos += literalLen;
+    if (src == end)             // last sequence
+      break;
+
+    // copy match
+    if (end - src < 2) return false;
+    unsigned long offset = src[0] | (src[1] << 8);
+    src += 2;
+    unsigned long matchLen = token & 15;
+    if (matchLen == 15)
+      do
+      {
+        if (src == end) return false;
+        matchLen += *src;
+      }
+      while (*src++ == 255);
+    matchLen += LZ4_MIN_MATCH;
+    if (offset == 0 || offset > pos || size - pos < matchLen)
+      return false;
+    // byte by byte because source and destination may overlap
+    for (unsigned long i = 0; i < matchLen; ++i, ++pos)
+      result[pos] = result[pos - offset];
+  }
+  return pos == size;
+}
+
+// SMSArchiveWriter members
+
+void SMSArchiveWriter::checkStream() throw(GsmException)
+{
+  if (_os.bad() || _os.fail())
+    throw GsmException(stringPrintf(_("error writing to file '%s'"),
+                                    _filename.c_str()), OSError);
+}
+
+SMSArchiveWriter::SMSArchiveWriter(std::string filename,
+                                   unsigned int blockSize)
+  throw(GsmException) :
+  _filename(filename), _blockSize(blockSize)
+{
+  _os.open(filename.c_str(), std::ios::out | std::ios::binary);
+  if (! _os)
+    throw GsmException(stringPrintf(_("error opening file '%s' for writing"),
+                                    filename.c_str()), OSError);
+
+  std::string header(SMS_ARCHIVE_MAGIC, 4);
+  putUnsignedShort(header, SMS_ARCHIVE_FILE_FORMAT_VERSION);
+  _os.write(header.data(), header.length());
+  checkStream();
+}
+
+void SMSArchiveWriter::add(const SMSStoreEntry &entry) throw(GsmException)
+{
+  SMSMessageRef message = entry.message();
+  std::string hexPdu = entry.encodedMessage();
+  unsigned int pduLen = hexPdu.length() / 2;
+  unsigned char *pdu = (unsigned char*)alloca(pduLen);
+  if (! hexToBuf(hexPdu, pdu))
+    throw GsmException(_("bad hexadecimal PDU format"), SMSFormatError);
+
+  // start a new block if this message does not fit
+  if (_summary._messages > 0 &&
+      _block.length() + MESSAGE_HEADER_SIZE + pduLen > _blockSize)
+    flush();
+
+  putUnsignedShort(_block, pduLen);
+  _block += (char)entry.messageType();
+  _block.append((const char*)pdu, pduLen);
+
+  // update block summary
+  Timestamp timestamp = message->serviceCentreTimestamp();
+  Address address = message->address();
+  if (_summary._messages == 0)
+  {
+    _summary._minTimestamp = _summary._maxTimestamp = timestamp;
+    _summary._minAddress = _summary._maxAddress = address;
+  }
+  else
+  {
+    if (timestamp < _summary._minTimestamp)
+      _summary._minTimestamp = timestamp;
+    if (_summary._maxTimestamp < timestamp)
+      _summary._maxTimestamp = timestamp;
+    if (address < _summary._minAddress)
+      _summary._minAddress = address;
+    if (_summary._maxAddress < address)
+      _summary._maxAddress = address;
+  }
+  ++_summary._messages;
+}
+
+void SMSArchiveWriter::flush() throw(GsmException)
+{
+  if (_summary._messages == 0)
+    return;
+
+  std::string compressed = compress(_block);
+  _summary._size = _block.length();
+  _summary._compressedSize = compressed.length();
+  std::string header = encodeBlockHeader(_summary);
+  putUnsignedLong(header, crc32(header.data(), header.length()));
+  putUnsignedLong(header, crc32(compressed.data(), compressed.length()));
+
+  _os.write(header.data(), header.length());
+  _os.write(compressed.data(), compressed.length());
+  _os.flush();
+  checkStream();
+
+  _block = "";
+  _summary = SMSArchiveBlock();
+}
+
+void SMSArchiveWriter::close() throw(GsmException)
+{
+  if (! _os.is_open())
+    return;
+  flush();
+  _os.close();
+  checkStream();
+}
+
+SMSArchiveWriter::~SMSArchiveWriter()
+{
+  try
+  {
+    close();
+  }
+  catch (GsmException &e)
+  {
+    // errors can only be reported by calling close() explicitly
+  }
+}
+
+// SMSArchive members
+
+SMSArchive::SMSArchive(std::string filename) throw(GsmException) :
+  _filename(filename)
+{
+  std::ifstream is(filename.c_str(), std::ios::in | std::ios::binary);
+  if (! is)
+    throw GsmException(stringPrintf(_("cannot open file '%s'"),
+                                    filename.c_str()), OSError);
+
+  is.seekg(0, std::ios::end);
+  unsigned long fileSize = is.tellg();
+  is.seekg(0);
+
+  char buf[BLOCK_HEADER_SIZE];
+  readnbytes(_filename, is, 6, buf);
+  if (memcmp(buf, SMS_ARCHIVE_MAGIC, 4) != 0 ||
+      getUnsignedShort(buf + 4) != SMS_ARCHIVE_FILE_FORMAT_VERSION)
+    throw GsmException(stringPrintf(_("file '%s' has wrong version"),
+                                    filename.c_str()), ParameterError);
+
+  // read the block summaries, skipping the compressed data
+  unsigned int index = 0;
+  while (is.peek() != EOF)
+  {
+    SMSArchiveBlock block;
+    readnbytes(_filename, is, BLOCK_HEADER_SIZE, buf);
+    block._size = getUnsignedLong(buf);
+    block._compressedSize = getUnsignedLong(buf + 4);
+    block._messages = getUnsignedLong(buf + 8);
+    block._minTimestamp = getTimestamp(buf + 12);
+    block._maxTimestamp = getTimestamp(buf + 18);
+    block._minAddress = readAddress(_filename, is);
+    block._maxAddress = readAddress(_filename, is);
+    readnbytes(_filename, is, 8, buf);
+    block._checksum = getUnsignedLong(buf + 4);
+    block._offset = is.tellg();
+    block._firstIndex = index;
+    index += block._messages;
+
+    // the sizes must not be trusted before the header is checked
+    // and the compressed data must be complete
+    std::string header = encodeBlockHeader(block);
+    if (crc32(header.data(), header.length()) != getUnsignedLong(buf) ||
+        block._compressedSize > fileSize - block._offset)
+      throw GsmException(stringPrintf(_("corrupt SMS archive file '%s'"),
+                                      filename.c_str()), ParameterError);
+
+    is.seekg(block._compressedSize, std::ios::cur);
+    if (is.bad() || is.fail())
+      throw GsmException(stringPrintf(_("error reading from file '%s'"),
+                                      filename.c_str()), OSError);
+    _blocks.push_back(block);
+  }
+}
+
+void SMSArchive::readBlock(unsigned int i,
+                           std::vector<SMSStoreEntryRef> &result) const
+  throw(GsmException)
+{
+  const SMSArchiveBlock &block = _blocks[i];
+  std::ifstream is(_filename.c_str(), std::ios::in | std::ios::binary);
+  if (! is)
+    throw GsmException(stringPrintf(_("cannot open file '%s'"),
+                                    _filename.c_str()), OSError);
+  is.seekg(block._offset);
+
+  std::string compressed(block._compressedSize, '\0');
+  if (block._compressedSize > 0)
+    readnbytes(_filename, is, block._compressedSize, &compressed[0]);
+  std::string data;
+  if (crc32(compressed.data(), compressed.length()) != block._checksum ||
+      ! decompress(compressed, block._size, data))
+    throw GsmException(stringPrintf(_("corrupt SMS archive file '%s'"),
+                                    _filename.c_str()), ParameterError);
+
+  unsigned int index = block._firstIndex;
+  for (unsigned long pos = 0; pos < data.length();)
+  {
+    if (data.length() - pos < MESSAGE_HEADER_SIZE)
+      throw GsmException(stringPrintf(_("corrupt SMS archive file '%s'"),
+                                      _filename.c_str()), ParameterError);
+    unsigned int pduLen = getUnsignedShort(data.data() + pos);
+    unsigned char messageType = data[pos + 2];
+    pos += MESSAGE_HEADER_SIZE;
+    if (data.length() - pos < pduLen || messageType > 2)
+      throw GsmException(stringPrintf(_("corrupt SMS archive file '%s'"),
+                                      _filename.c_str()), ParameterError);
+
+    result.push_back(
+      new SMSStoreEntry(bufToHex((const unsigned char*)data.data() + pos,
+                                 pduLen),
+                        (SMSMessage::MessageType)messageType, index++));
+    pos += pduLen;
+  }
+}
+
+void SMSArchive::find(const Timestamp &from, const Timestamp &to,
+                      std::vector<SMSStoreEntryRef> &result) const
+  throw(GsmException)
+{
+  for (unsigned int i = 0; i < _blocks.size(); ++i)
+    if (_blocks[i].mayContain(from, to))
+    {
+      std::vector<SMSStoreEntryRef> entries;
+      readBlock(i, entries);
+      for (std::vector<SMSStoreEntryRef>::iterator j = entries.begin();
+           j != entries.end(); ++j)
+      {
+        Timestamp timestamp = (*j)->message()->serviceCentreTimestamp();
+        if (! (timestamp < from) && ! (to < timestamp))
+          result.push_back(*j);
+      }
+    }
+}
+
+void SMSArchive::find(const Address &address,
+                      std::vector<SMSStoreEntryRef> &result) const
+  throw(GsmException)
+{
+  for (unsigned int i = 0; i < _blocks.size(); ++i)
+    if (_blocks[i].mayContain(address))
+    {
+      std::vector<SMSStoreEntryRef> entries;
+      readBlock(i, entries);
+      for (std::vector<SMSStoreEntryRef>::iterator j = entries.begin();
+           j != entries.end(); ++j)
+      {
+        // same notion of equality as the ByAddress index of SortedSMSStore
+        Address a = (*j)->message()->address();
+        if (! (a < address) && ! (address < a))
+          result.push_back(*j);
+      }
+    }
+}
@@ -0,0 +1,131 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_sms_archive.h
+// *
+// * Purpose: Block-compressed archive files for SMS messages
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef GSM_SMS_ARCHIVE_H
+#define GSM_SMS_ARCHIVE_H
+
+#include <gsmlib/gsm_sms_store.h>
+#include <gsmlib/gsm_sms_codec.h>
+#include <gsmlib/gsm_util.h>
+#include <string>
+#include <vector>
+#include <fstream>
+
+namespace gsmlib
+{
+  // default size of the uncompressed data of one archive block
+  const unsigned int DEFAULT_SMS_ARCHIVE_BLOCK_SIZE = 65536;
+
+  // summary of one block of an SMS archive
+  // the timestamp and address ranges allow queries to skip whole blocks
+
+  struct SMSArchiveBlock
+  {
+    unsigned long _offset;      // offset of compressed data in the file
+    unsigned long _size;        // size of uncompressed data
+    unsigned long _compressedSize; // size of compressed data
+    unsigned long _checksum;    // CRC-32 of compressed data
+    unsigned int _messages;     // number of messages in the block
+    unsigned int _firstIndex;   // archive index of first message in block
+    Timestamp _minTimestamp, _maxTimestamp; // service centre timestamps
+    Address _minAddress, _maxAddress;
+
+    SMSArchiveBlock() : _offset(0), _size(0), _compressedSize(0),
+      _checksum(0), _messages(0), _firstIndex(0) {}
+
+    // return true if the block may contain messages with timestamps
+    // in the range [from, to]
+    bool mayContain(const Timestamp &from, const Timestamp &to) const
+      {return ! (to < _minTimestamp) && ! (_maxTimestamp < from);}
+
+    // return true if the block may contain messages from or to address
+    bool mayContain(const Address &address) const
+      {return ! (address < _minAddress) && ! (_maxAddress < address);}
+  };
+
+  // The class SMSArchiveWriter creates a new archive file
+  // messages are collected into blocks of (at most) blockSize bytes,
+  // each block is compressed independently
+
+  class SMSArchiveWriter : public RefBase, public NoCopy
+  {
+  private:
+    std::string _filename;      // name of the archive file
+    std::ofstream _os;          // archive file
+    unsigned int _blockSize;    // maximum size of uncompressed block
+    std::string _block;         // uncompressed data of the current block
+    SMSArchiveBlock _summary;   // summary of the current block
+
+    // throw an exception if the archive file is bad
+    void checkStream() throw(GsmException);
+
+  public:
+    // create archive file (an existing file is overwritten)
+    SMSArchiveWriter(std::string filename,
+                     unsigned int blockSize = DEFAULT_SMS_ARCHIVE_BLOCK_SIZE)
+      throw(GsmException);
+
+    // add message to archive
+    void add(const SMSStoreEntry &entry) throw(GsmException);
+
+    // compress and write the current block
+    void flush() throw(GsmException);
+
+    // write the last block and close the archive file
+    void close() throw(GsmException);
+
+    // destructor
+    // calls close(), errors are ignored
+    ~SMSArchiveWriter();
+  };
+
+  // The class SMSArchive reads archive files
+  // only the block summaries are kept in memory, messages are read
+  // block by block
+
+  class SMSArchive : public RefBase, public NoCopy
+  {
+  private:
+    std::string _filename;      // name of the archive file
+    std::vector<SMSArchiveBlock> _blocks; // summaries of all blocks
+
+  public:
+    // open archive file and read the block summaries
+    SMSArchive(std::string filename) throw(GsmException);
+
+    // return number of blocks in the archive
+    unsigned int blocks() const {return _blocks.size();}
+
+    // return summary of block i
+    const SMSArchiveBlock &block(unsigned int i) const {return _blocks[i];}
+
+    // read the messages of block i and append them to result
+    // each call opens the archive file on its own, so different blocks
+    // may be read concurrently
+    // the messages are decoded when they are accessed for the first time
+    void readBlock(unsigned int i, std::vector<SMSStoreEntryRef> &result)
+      const throw(GsmException);
+
+    // append messages with service centre timestamps in the range
+    // [from, to] to result
+    void find(const Timestamp &from, const Timestamp &to,
+              std::vector<SMSStoreEntryRef> &result) const
+      throw(GsmException);
+
+    // append messages from or to address to result
+    void find(const Address &address,
+              std::vector<SMSStoreEntryRef> &result) const
+      throw(GsmException);
+  };
+
+  typedef Ref<SMSArchive> SMSArchiveRef;
+};
+
+#endif // GSM_SMS_ARCHIVE_H
@@ -125,7 +125,7 @@ std::string Timestamp::toString(bool appendTimeZone) const
   std::ostringstream os;
   os << formattedTime << " (" << (_negativeTimeZone ? '-' : '+')
      << std::setfill('0') << std::setw(2) << timeZoneHours 
-     << std::setw(2) << timeZoneMinutes << ')' << std::ends;
+     << std::setw(2) << timeZoneMinutes << ')';
   return os.str();
 }
 
@@ -188,7 +188,6 @@ std::string TimePeriod::toString() const
 	  os << (int)_relativeTime - 166 << _(" days");
 	else if (_relativeTime <= 143)
 	  os << (int)_relativeTime - 192 << _(" weeks");
-	os << std::ends;
 	return os.str();
       }
     case Absolute:
@@ -539,7 +538,7 @@ void SMSEncoder::setSemiOctetsInteger(unsigned long intValue,
 				      unsigned short length)
 {
   std::ostringstream os;
-  os << intValue << std::ends;
+  os << intValue;
   std::string s(os.str());
   assert(s.length() <= length);
   while (s.length() < length) s = '0' + s;
@@ -0,0 +1,611 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_sms_search_index.cc
+// *
+// * Purpose: Full-text and address index for SMS store files
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_nls.h>
+#include <gsmlib/gsm_sysdep.h>
+#include <gsmlib/gsm_sms_search_index.h>
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <cstdio>
+#include <errno.h>
+
+using namespace gsmlib;
+
+// SMS search index file format:
+// "GSMI" followed by the version number of the file format, unsigned
+// short int, 2 bytes in network byte order
+// then:
+// 1. number of tokens in the sorted part: 4 bytes in network byte order
+// 2. size of the header and the sorted part: 4 bytes in network byte order
+// 3. one beyond the largest message identifier in the sorted part:
+//    4 bytes in network byte order
+// the sorted part consists of a directory with the offsets of the tokens
+// in the file (4 bytes each in network byte order) followed by the tokens
+// in ascending order:
+// 1. length of token (1 byte)
+// 2. token
+// 3. number of identifiers: 4 bytes in network byte order
+// 4. identifiers of the messages in ascending order: 4 bytes each in
+//    network byte order
+// after the sorted part come the postings appended when messages were
+// added:
+// 1. length of token (1 byte)
+// 2. token
+// 3. identifier of the message: 4 bytes in network byte order
+// a posting that extends beyond the end of the file is the remainder of an
+// interrupted append, the file is rewritten when it is opened
+
+static const char SMS_SEARCH_INDEX_MAGIC[] = "GSMI";
+static const unsigned short int SMS_SEARCH_INDEX_FILE_FORMAT_VERSION = 1;
+
+// size of the file header (magic, version number and items 1. to 3.)
+static const unsigned int SEARCH_INDEX_HEADER_SIZE = 18;
+
+// maximum length of a token in bytes (longer words are truncated)
+static const unsigned int MAX_TOKEN_LENGTH = 64;
+
+// the index file is rewritten if it has more appended postings than this
+static const unsigned int SEARCH_INDEX_MAX_APPENDED = 65536;
+
+// aux functions to encode and decode integers in network byte order
+
+static void putUnsignedShort(std::string &s, unsigned int value)
+{
+  s += (char)((value >> 8) & 0xff);
+  s += (char)(value & 0xff);
+}
+
+static void putUnsignedLong(std::string &s, unsigned long value)
+{
+  putUnsignedShort(s, (value >> 16) & 0xffff);
+  putUnsignedShort(s, value & 0xffff);
+}
+
+static unsigned int getUnsignedShort(const char *buf)
+{
+  return ((unsigned char)buf[0] << 8) | (unsigned char)buf[1];
+}
+
+static unsigned long getUnsignedLong(const char *buf)
+{
+  return ((unsigned long)getUnsignedShort(buf) << 16) |
+    getUnsignedShort(buf + 2);
+}
+
+// aux function read bytes with error handling
+// return false if EOF
+static bool readnbytes(const std::string &filename, std::istream &is,
+                       int len, char *buf, bool eofIsError = true)
+  throw(GsmException)
+{
+  is.read(buf, len);
+  if (is.bad() || (is.eof() && eofIsError))
+    throw GsmException(stringPrintf(_("error reading from file '%s'"),
+                                    filename.c_str()), OSError);
+  return ! is.eof();
+}
+
+// aux function to read a token (length and characters)
+static bool readToken(const std::string &filename, std::istream &is,
+                      std::string &token, bool eofIsError = true)
+  throw(GsmException)
+{
+  char buf[256];
+  if (! readnbytes(filename, is, 1, buf, eofIsError))
+    return false;
+  unsigned int len = (unsigned char)buf[0];
+  if (! readnbytes(filename, is, len, buf, eofIsError))
+    return false;
+  token.assign(buf, len);
+  return true;
+}
+
+// aux functions for tokenizing
+
+// return true if c is a letter or a digit
+static bool isWordCharacter(unsigned int c)
+{
+  if (c < 0x100)
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+      (c >= 'A' && c <= 'Z') || (c >= 0xc0 && c != 0xd7 && c != 0xf7);
+  // general punctuation and CJK symbols and punctuation
+  return ! (c >= 0x2000 && c <= 0x206f) && ! (c >= 0x3000 && c <= 0x303f);
+}
+
+// convert c to lower case (Latin-1, Greek and Cyrillic)
+static unsigned int lowerCharacter(unsigned int c)
+{
+  if ((c >= 'A' && c <= 'Z') || (c >= 0xc0 && c <= 0xde && c != 0xd7) ||
+      (c >= 0x391 && c <= 0x3a9 && c != 0x3a2) ||
+      (c >= 0x410 && c <= 0x42f))
+    return c + 0x20;
+  if (c >= 0x400 && c <= 0x40f)
+    return c + 0x50;
+  return c;
+}
+
+// append c to token UTF-8 encoded, return false if the token would
+// become too long
+static bool appendCharacter(std::string &token, unsigned int c)
+{
+  std::string s;
+  if (c < 0x80)
+    s += (char)c;
+  else if (c < 0x800)
+  {
+    s += (char)(0xc0 | (c >> 6));
+    s += (char)(0x80 | (c & 0x3f));
+  }
+  else if (c < 0x10000)
+  {
+    s += (char)(0xe0 | (c >> 12));
+    s += (char)(0x80 | ((c >> 6) & 0x3f));
+    s += (char)(0x80 | (c & 0x3f));
+  }
+  else
+  {
+    s += (char)(0xf0 | (c >> 18));
+    s += (char)(0x80 | ((c >> 12) & 0x3f));
+    s += (char)(0x80 | ((c >> 6) & 0x3f));
+    s += (char)(0x80 | (c & 0x3f));
+  }
+  if (token.length() + s.length() > MAX_TOKEN_LENGTH)
+    return false;
+  token += s;
+  return true;
+}
+
+// decode UTF-8 text into chars, bytes that do not start a valid sequence
+// are taken as Latin-1 characters
+static void decodeUTF8(const std::string &text,
+                       std::vector<unsigned int> &chars)
+{
+  unsigned int i = 0;
+  while (i < text.length())
+  {
+    unsigned char c = text[i];
+    unsigned int len = 1, value = c;
+    if (c >= 0xc2 && c < 0xe0)
+    {
+      len = 2;
+      value = c & 0x1f;
+    }
+    else if (c >= 0xe0 && c < 0xf0)
+    {
+      len = 3;
+      value = c & 0x0f;
+    }
+    else if (c >= 0xf0 && c < 0xf5)
+    {
+      len = 4;
+      value = c & 0x07;
+    }
+    unsigned int j;
+    for (j = 1; j < len && i + j < text.length() &&
+           ((unsigned char)text[i + j] & 0xc0) == 0x80; ++j)
+      value = (value << 6) | ((unsigned char)text[i + j] & 0x3f);
+    if (j < len)
+    {
+      len = 1;
+      value = c;
+    }
+    chars.push_back(value);
+    i += len;
+  }
+}
+
+// split text into words and insert them into tokens
+static void splitWords(const std::vector<unsigned int> &text,
+                       std::set<std::string> &tokens)
+{
+  std::string word;
+  bool truncated = false;
+  for (std::vector<unsigned int>::const_iterator i = text.begin();
+       i != text.end(); ++i)
+    if (isWordCharacter(*i))
+    {
+      if (! truncated)
+        truncated = ! appendCharacter(word, lowerCharacter(*i));
+    }
+    else if (word.length() > 0)
+    {
+      tokens.insert(word);
+      word = "";
+      truncated = false;
+    }
+  if (word.length() > 0)
+    tokens.insert(word);
+}
+
+// SMSSearchIndex members
+
+SMSSearchIndex::SMSSearchIndex(std::string filename) throw(GsmException) :
+  _filename(filename), _tokens(0), _end(0), _nextId(0)
+{
+  std::ifstream is(filename.c_str(), std::ios::in | std::ios::binary);
+  if (! is)
+  {
+    // start with an empty index
+    write(std::map<std::string, std::vector<unsigned int> >(), 0);
+    return;
+  }
+
+  char buf[SEARCH_INDEX_HEADER_SIZE];
+  readnbytes(_filename, is, SEARCH_INDEX_HEADER_SIZE, buf);
+  if (memcmp(buf, SMS_SEARCH_INDEX_MAGIC, 4) != 0 ||
+      getUnsignedShort(buf + 4) != SMS_SEARCH_INDEX_FILE_FORMAT_VERSION)
+    throw GsmException(stringPrintf(_("file '%s' has wrong version"),
+                                    filename.c_str()), ParameterError);
+  _tokens = getUnsignedLong(buf + 6);
+  _end = getUnsignedLong(buf + 10);
+  _nextId = getUnsignedLong(buf + 14);
+
+  is.seekg(0, std::ios::end);
+  if ((unsigned long)is.tellg() < _end)
+    throw GsmException(stringPrintf(_("corrupt SMS search index file '%s'"),
+                                    filename.c_str()), ParameterError);
+
+  // read the appended postings
+  is.seekg(_end);
+  bool interrupted = false;
+  while (is.peek() != EOF)
+  {
+    std::string token;
+    if (! readToken(_filename, is, token, false) ||
+        ! readnbytes(_filename, is, 4, buf, false))
+    {
+      interrupted = true;
+      break;
+    }
+    unsigned int id = getUnsignedLong(buf);
+    _appended.insert(std::make_pair(token, id));
+    if (id >= _nextId)
+      _nextId = id + 1;
+    _end = is.tellg();
+  }
+  is.close();
+
+  if (interrupted || _appended.size() > SEARCH_INDEX_MAX_APPENDED)
+    merge();
+}
+
+std::vector<std::string> SMSSearchIndex::tokens(const SMSMessage &message)
+{
+  std::string userData = message.userData();
+  std::vector<unsigned int> text;
+  switch (message.dataCodingScheme().getAlphabet())
+  {
+  case DCS_DEFAULT_ALPHABET:
+    for (unsigned int i = 0; i < userData.length(); ++i)
+      text.push_back((unsigned char)userData[i]);
+    break;
+  case DCS_SIXTEEN_BIT_ALPHABET:
+    for (unsigned int i = 0; i + 1 < userData.length(); i += 2)
+      text.push_back(getUnsignedShort(userData.data() + i));
+    break;
+  default:
+    // binary data is not indexed
+    break;
+  }
+
+  std::set<std::string> result;
+  splitWords(text, result);
+  std::string addressToken = token(message.address());
+  if (addressToken.length() > 1)
+    result.insert(addressToken);
+  return std::vector<std::string>(result.begin(), result.end());
+}
+
+std::vector<std::string> SMSSearchIndex::tokens(std::string text)
+{
+  std::vector<unsigned int> chars;
+  decodeUTF8(text, chars);
+  std::set<std::string> result;
+  splitWords(chars, result);
+  return std::vector<std::string>(result.begin(), result.end());
+}
+
+std::string SMSSearchIndex::token(const Address &address)
+{
+  // "@" keeps addresses apart from words, the type of number is ignored
+  std::string number = lowercase(removeWhiteSpace(address._number));
+  if (number.length() > 0 && number[0] == '+')
+    number.erase(0, 1);
+  return "@" + number.substr(0, MAX_TOKEN_LENGTH - 1);
+}
+
+void SMSSearchIndex::addPostings(const SMSStoreEntry &entry,
+                                 std::string &records) throw(GsmException)
+{
+  unsigned int id = entry.index();
+  SMSMessageRef message = entry.message();
+  if (! message.isnull())
+  {
+    std::vector<std::string> entryTokens = tokens(message());
+    for (std::vector<std::string>::iterator i = entryTokens.begin();
+         i != entryTokens.end(); ++i)
+    {
+      records += (char)i->length();
+      records += *i;
+      putUnsignedLong(records, id);
+      _appended.insert(std::make_pair(*i, id));
+    }
+  }
+  if (id >= _nextId)
+    _nextId = id + 1;
+}
+
+void SMSSearchIndex::append(const std::string &records) throw(GsmException)
+{
+  if (records.length() == 0)
+    return;
+
+  // the file always exists, so it can be opened for update
+  std::fstream os(_filename.c_str(),
+                  std::ios::in | std::ios::out | std::ios::binary);
+  if (! os)
+    throw GsmException(stringPrintf(_("error opening file '%s' for writing"),
+                                    _filename.c_str()), OSError);
+  os.seekp(_end);
+  os.write(records.data(), records.length());
+  os.flush();
+  if (! os)
+    throw GsmException(stringPrintf(_("error writing to file '%s'"),
+                                    _filename.c_str()), OSError);
+  _end += records.length();
+}
+
+void SMSSearchIndex::write(const std::map<std::string,
+                           std::vector<unsigned int> > &postings,
+                           unsigned int nextId) throw(GsmException)
+{
+  typedef std::map<std::string, std::vector<unsigned int> > PostingsMap;
+
+  // header and directory
+  std::string header(SMS_SEARCH_INDEX_MAGIC, 4);
+  putUnsignedShort(header, SMS_SEARCH_INDEX_FILE_FORMAT_VERSION);
+  unsigned long offset = SEARCH_INDEX_HEADER_SIZE + 4 * postings.size();
+  std::string directory;
+  for (PostingsMap::const_iterator i = postings.begin();
+       i != postings.end(); ++i)
+  {
+    putUnsignedLong(directory, offset);
+    offset += 1 + i->first.length() + 4 + 4 * i->second.size();
+  }
+  putUnsignedLong(header, postings.size());
+  putUnsignedLong(header, offset);
+  putUnsignedLong(header, nextId);
+
+  // write to a new file, then replace the old one
+  std::string newFilename = _filename + ".new";
+  std::ofstream os(newFilename.c_str(),
+                   std::ios::out | std::ios::trunc | std::ios::binary);
+  os.write(header.data(), header.length());
+  os.write(directory.data(), directory.length());
+  for (PostingsMap::const_iterator i = postings.begin();
+       i != postings.end() && os; ++i)
+  {
+    std::string s;
+    s += (char)i->first.length();
+    s += i->first;
+    putUnsignedLong(s, i->second.size());
+    for (std::vector<unsigned int>::const_iterator j = i->second.begin();
+         j != i->second.end(); ++j)
+      putUnsignedLong(s, *j);
+    os.write(s.data(), s.length());
+  }
+  os.close();
+  if (! os)
+    throw GsmException(stringPrintf(_("error writing to file '%s'"),
+                                    newFilename.c_str()), OSError);
+#ifndef HAVE_UNISTD_H
+  // rename() does not replace existing files on Win32
+  remove(_filename.c_str());
+#endif
+  if (rename(newFilename.c_str(), _filename.c_str()) < 0)
+    throw GsmException(stringPrintf(_("error renaming '%s' to '%s'"),
+                                    newFilename.c_str(), _filename.c_str()),
+                       OSError, errno);
+
+  _tokens = postings.size();
+  _end = offset;
+  _nextId = nextId;
+  _appended.clear();
+}
+
+void SMSSearchIndex::lookup(const std::string &token,
+                            std::set<unsigned int> &ids) throw(GsmException)
+{
+  for (std::multimap<std::string, unsigned int>::iterator i =
+         _appended.lower_bound(token);
+       i != _appended.end() && i->first == token; ++i)
+    ids.insert(i->second);
+
+  if (_tokens == 0)
+    return;
+
+  // binary search in the sorted part
+  std::ifstream is(_filename.c_str(), std::ios::in | std::ios::binary);
+  if (! is)
+    throw GsmException(stringPrintf(_("cannot open file '%s'"),
+                                    _filename.c_str()), OSError);
+  char buf[4];
+  unsigned int low = 0, high = _tokens;
+  while (low < high)
+  {
+    unsigned int middle = (low + high) / 2;
+    is.seekg(SEARCH_INDEX_HEADER_SIZE + 4 * middle);
+    readnbytes(_filename, is, 4, buf);
+    is.seekg(getUnsignedLong(buf));
+    std::string middleToken;
+    readToken(_filename, is, middleToken);
+
+    int cmp = middleToken.compare(token);
+    if (cmp == 0)
+    {
+      readnbytes(_filename, is, 4, buf);
+      unsigned long count = getUnsignedLong(buf);
+      std::string data(4 * count, 0);
+      if (count > 0)
+        readnbytes(_filename, is, data.length(), &data[0]);
+      for (unsigned long i = 0; i < count; ++i)
+        ids.insert(getUnsignedLong(data.data() + 4 * i));
+      return;
+    }
+    if (cmp < 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+}
+
+void SMSSearchIndex::add(const SMSStoreEntry &entry) throw(GsmException)
+{
+  std::string records;
+  addPostings(entry, records);
+  append(records);
+}
+
+void SMSSearchIndex::update(SortedSMSStore &store) throw(GsmException)
+{
+  SMSStoreMap &byIndex = store._sortedSMSStore[ByIndex];
+  std::string records;
+  for (SMSStoreMap::iterator i =
+         byIndex.lower_bound(SMSMapKey(store, ByIndex, (int)_nextId));
+       i != byIndex.end(); ++i)
+    addPostings(*i->second, records);
+  append(records);
+  if (store._nextIndex > _nextId)
+    _nextId = store._nextIndex;
+
+  if (_appended.size() > SEARCH_INDEX_MAX_APPENDED)
+    merge();
+}
+
+void SMSSearchIndex::rebuild(SortedSMSStore &store) throw(GsmException)
+{
+  std::map<std::string, std::vector<unsigned int> > postings;
+  SMSStoreMap &byIndex = store._sortedSMSStore[ByIndex];
+  for (SMSStoreMap::iterator i = byIndex.begin(); i != byIndex.end(); ++i)
+  {
+    SMSMessageRef message = i->second->message();
+    if (message.isnull())
+      continue;
+    std::vector<std::string> entryTokens = tokens(message());
+    for (std::vector<std::string>::iterator j = entryTokens.begin();
+         j != entryTokens.end(); ++j)
+      postings[*j].push_back(i->second->index());
+  }
+  write(postings, store._nextIndex);
+}
+
+void SMSSearchIndex::merge() throw(GsmException)
+{
+  std::map<std::string, std::vector<unsigned int> > postings;
+
+  // read the sorted part
+  std::ifstream is(_filename.c_str(), std::ios::in | std::ios::binary);
+  if (! is)
+    throw GsmException(stringPrintf(_("cannot open file '%s'"),
+                                    _filename.c_str()), OSError);
+  is.seekg(SEARCH_INDEX_HEADER_SIZE + 4 * _tokens);
+  char buf[4];
+  for (unsigned int i = 0; i < _tokens; ++i)
+  {
+    std::string token;
+    readToken(_filename, is, token);
+    readnbytes(_filename, is, 4, buf);
+    unsigned long count = getUnsignedLong(buf);
+    std::vector<unsigned int> &ids = postings[token];
+    for (unsigned long j = 0; j < count; ++j)
+    {
+      readnbytes(_filename, is, 4, buf);
+      ids.push_back(getUnsignedLong(buf));
+    }
+  }
+  is.close();
+
+  // add the appended postings
+  for (std::multimap<std::string, unsigned int>::iterator i =
+         _appended.begin(); i != _appended.end(); ++i)
+    postings[i->first].push_back(i->second);
+  for (std::map<std::string, std::vector<unsigned int> >::iterator i =
+         postings.begin(); i != postings.end(); ++i)
+  {
+    std::sort(i->second.begin(), i->second.end());
+    i->second.erase(std::unique(i->second.begin(), i->second.end()),
+                    i->second.end());
+  }
+  write(postings, _nextId);
+}
+
+void SMSSearchIndex::find(SortedSMSStore &store,
+                          const std::vector<std::string> &words,
+                          std::vector<SortedSMSStore::iterator> &result)
+  throw(GsmException)
+{
+  if (words.size() == 0)
+    return;
+
+  // intersect the identifiers of all words
+  std::set<unsigned int> ids;
+  lookup(words[0], ids);
+  for (unsigned int i = 1; i < words.size() && ids.size() > 0; ++i)
+  {
+    std::set<unsigned int> wordIds, intersection;
+    lookup(words[i], wordIds);
+    std::set_intersection(ids.begin(), ids.end(),
+                          wordIds.begin(), wordIds.end(),
+                          std::inserter(intersection, intersection.begin()));
+    ids.swap(intersection);
+  }
+
+  SMSStoreMap &byIndex = store._sortedSMSStore[ByIndex];
+  for (std::set<unsigned int>::iterator i = ids.begin(); i != ids.end(); ++i)
+  {
+    SMSStoreMap::iterator entry =
+      byIndex.find(SMSMapKey(store, ByIndex, (int)*i));
+    if (entry == byIndex.end())
+      continue;                 // erased
+
+    // check the message, the identifier of an erased message may have
+    // been reused
+    SMSMessageRef message = entry->second->message();
+    if (message.isnull())
+      continue;
+    std::vector<std::string> entryTokens = tokens(message());
+    bool matches = true;
+    for (std::vector<std::string>::const_iterator j = words.begin();
+         j != words.end() && matches; ++j)
+      matches = std::binary_search(entryTokens.begin(), entryTokens.end(),
+                                   *j);
+    if (matches)
+      result.push_back(entry);
+  }
+}
+
+void SMSSearchIndex::find(SortedSMSStore &store, std::string text,
+                          std::vector<SortedSMSStore::iterator> &result)
+  throw(GsmException)
+{
+  find(store, tokens(text), result);
+}
+
+void SMSSearchIndex::find(SortedSMSStore &store, const Address &address,
+                          std::vector<SortedSMSStore::iterator> &result)
+  throw(GsmException)
+{
+  find(store, std::vector<std::string>(1, token(address)), result);
+}
@@ -0,0 +1,111 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_sms_search_index.h
+// *
+// * Purpose: Full-text and address index for SMS store files
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef GSM_SMS_SEARCH_INDEX_H
+#define GSM_SMS_SEARCH_INDEX_H
+
+#include <gsmlib/gsm_sorted_sms_store.h>
+#include <gsmlib/gsm_sms.h>
+#include <gsmlib/gsm_util.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+namespace gsmlib
+{
+  // The class SMSSearchIndex is an inverted index for a file-based
+  // SortedSMSStore, it maps the words of the user data and the address
+  // of each message to the identifiers (SMSStoreEntry::index()) of the
+  // messages containing them
+  // - the index file consists of a sorted part that is searched without
+  //   reading it into memory, followed by postings that were appended
+  //   when messages were added; merge() moves these into the sorted part
+  // - identifiers are used instead of file offsets because they do not
+  //   change when the store file is compacted
+  // - erased messages are not removed from the index, they are skipped
+  //   when the query results are looked up in the store
+  // - words are the runs of letters and digits in the user data, they are
+  //   converted to lower case and stored UTF-8 encoded
+
+  class SMSSearchIndex : public RefBase, public NoCopy
+  {
+  private:
+    std::string _filename;      // name of the index file
+    unsigned int _tokens;       // number of tokens in the sorted part
+    unsigned long _end;         // size of the valid part of the file
+    unsigned int _nextId;       // one beyond the largest indexed identifier
+    std::multimap<std::string, unsigned int> _appended;
+                                // postings after the sorted part
+
+    // add the postings of entry to _appended and their encoding to records
+    void addPostings(const SMSStoreEntry &entry, std::string &records)
+      throw(GsmException);
+
+    // append encoded postings to the file
+    void append(const std::string &records) throw(GsmException);
+
+    // write a new index file consisting of a sorted part only
+    void write(const std::map<std::string, std::vector<unsigned int> >
+               &postings, unsigned int nextId) throw(GsmException);
+
+    // insert identifiers of messages containing token into ids
+    void lookup(const std::string &token, std::set<unsigned int> &ids)
+      throw(GsmException);
+
+    // look up messages containing all words in store, append them to
+    // result
+    void find(SortedSMSStore &store, const std::vector<std::string> &words,
+              std::vector<SortedSMSStore::iterator> &result)
+      throw(GsmException);
+
+  public:
+    // open index file, create an empty index if it does not exist
+    SMSSearchIndex(std::string filename) throw(GsmException);
+
+    // return the tokens (words and address) of message
+    static std::vector<std::string> tokens(const SMSMessage &message);
+
+    // return the tokens of text (UTF-8) and of address
+    static std::vector<std::string> tokens(std::string text);
+    static std::string token(const Address &address);
+
+    // return one beyond the largest identifier in the index
+    unsigned int nextId() const {return _nextId;}
+
+    // add message to the index
+    void add(const SMSStoreEntry &entry) throw(GsmException);
+
+    // add the messages of store that are not yet in the index
+    void update(SortedSMSStore &store) throw(GsmException);
+
+    // replace the index by a new index of all messages of store
+    void rebuild(SortedSMSStore &store) throw(GsmException);
+
+    // rewrite the index file, moving the appended postings into the
+    // sorted part
+    void merge() throw(GsmException);
+
+    // append the messages of store containing all words of text (UTF-8)
+    // or from or to address to result
+    // the iterators are not into the current sort order of store, so they
+    // must not be compared against store.end()
+    void find(SortedSMSStore &store, std::string text,
+              std::vector<SortedSMSStore::iterator> &result)
+      throw(GsmException);
+    void find(SortedSMSStore &store, const Address &address,
+              std::vector<SortedSMSStore::iterator> &result)
+      throw(GsmException);
+  };
+
+  typedef Ref<SMSSearchIndex> SMSSearchIndexRef;
+};
+
+#endif // GSM_SMS_SEARCH_INDEX_H
@@ -24,24 +24,58 @@ using namespace gsmlib;
 // SMSStoreEntry members
 
 SMSStoreEntry::SMSStoreEntry() :
-   _status(Unknown), _cached(false), _mySMSStore(NULL), _index(0)
+   _status(Unknown), _cached(false), _mySMSStore(NULL), _index(0),
+   _pduType(SMSMessage::SMS_DELIVER)
 {
 }
 
 
-SMSMessageRef SMSStoreEntry::message() const throw(GsmException)
+SMSStoreEntry::SMSMemoryStatus SMSStoreEntry::load() const
+  throw(GsmException)
 {
-  if (! cached())
+  // these operations are at least "logically const"
+  SMSStoreEntry *thisEntry = const_cast<SMSStoreEntry*>(this);
+  SMSMemoryStatus status = _status;
+  if (_mySMSStore == NULL)
+  {
+    // entry read from file, decode it now
+    thisEntry->_message =
+      SMSMessage::decode(_pdu, (_pduType != SMSMessage::SMS_SUBMIT));
+    thisEntry->_pdu = "";
+  }
+  else
   {
-    assert(_mySMSStore != NULL);
-    // these operations are at least "logically const"
-    SMSStoreEntry *thisEntry = const_cast<SMSStoreEntry*>(this);
-    _mySMSStore->readEntry(_index, thisEntry->_message, thisEntry->_status);
-    thisEntry->_cached = true;
+    _mySMSStore->readEntry(_index, thisEntry->_message, status);
+    // reading an unread message marks it as read in the ME, this only
+    // applies to the cached entry, not to this access
+    thisEntry->_status = status == ReceivedUnread ? ReceivedRead : status;
   }
+  thisEntry->_cached = true;
+  return status;
+}
+
+SMSMessageRef SMSStoreEntry::message() const throw(GsmException)
+{
+  if (! cached())
+    load();
   return _message;
 }
 
+SMSMessage::MessageType SMSStoreEntry::messageType() const
+  throw(GsmException)
+{
+  if (_mySMSStore == NULL && ! _cached)
+    return _pduType;
+  return message()->messageType();
+}
+
+std::string SMSStoreEntry::encodedMessage() const throw(GsmException)
+{
+  if (_mySMSStore == NULL && ! _cached)
+    return _pdu;
+  return message()->encode();
+}
+
 CBMessageRef SMSStoreEntry::cbMessage() const throw(GsmException)
 {
   assert(_mySMSStore != NULL);
@@ -60,13 +94,7 @@ SMSStoreEntry::SMSMemoryStatus SMSStoreEntry::status() const
   throw(GsmException)
 {
   if (! cached())
-  {
-    assert(_mySMSStore != NULL);
-    // these operations are at least "logically const"
-    SMSStoreEntry *thisEntry = const_cast<SMSStoreEntry*>(this);
-    _mySMSStore->readEntry(_index, thisEntry->_message, thisEntry->_status);
-    thisEntry->_cached = true;
-  }
+    return load();
   return _status;
 }
 
@@ -97,7 +125,7 @@ bool SMSStoreEntry::cached() const
 
 Ref<SMSStoreEntry> SMSStoreEntry::clone()
 {
-  Ref<SMSStoreEntry> result = new SMSStoreEntry(_message->clone());
+  Ref<SMSStoreEntry> result = new SMSStoreEntry(message()->clone());
   result->_status = _status;
   result->_index = _index;
   return result;
@@ -105,10 +133,10 @@ Ref<SMSStoreEntry> SMSStoreEntry::clone()
 
 bool SMSStoreEntry::operator==(const SMSStoreEntry &e) const
 {
-  if (_message.isnull() || e._message.isnull())
-    return _message.isnull() && e._message.isnull();
+  if (message().isnull() || e.message().isnull())
+    return message().isnull() && e.message().isnull();
   else
-    return _message->encode() == e._message->encode();
+    return encodedMessage() == e.encodedMessage();
 }
 
 SMSStoreEntry::SMSStoreEntry(const SMSStoreEntry &e)
@@ -118,6 +146,8 @@ SMSStoreEntry::SMSStoreEntry(const SMSStoreEntry &e)
  _cached = e._cached;
  _mySMSStore = e._mySMSStore;
  _index = e._index;
+ _pdu = e._pdu;
+ _pduType = e._pduType;
 }
 
 SMSStoreEntry &SMSStoreEntry::operator=(const SMSStoreEntry &e)
@@ -127,6 +157,8 @@ SMSStoreEntry &SMSStoreEntry::operator=(const SMSStoreEntry &e)
  _cached = e._cached;
  _mySMSStore = e._mySMSStore;
  _index = e._index;
+ _pdu = e._pdu;
+ _pduType = e._pduType;
  return *this;
 }
 
@@ -257,7 +289,7 @@ void SMSStore::readEntry(int index, CBMessageRef &message)
     message = CBMessageRef(new CBMessage(pdu));
 }
 
-void SMSStore::writeEntry(int &index, SMSMessageRef message)
+void SMSStore::writeEntry(int &index, const SMSMessageRef &message)
   throw(GsmException)
 {
   // select SMS store
@@ -324,7 +356,7 @@ unsigned char SMSStore::send(int index, Ref<SMSMessage> &ackPdu)
   return messageReference;
 }
 
-int SMSStore::doInsert(SMSMessageRef message)
+int SMSStore::doInsert(const SMSMessageRef &message)
   throw(GsmException)
 {
   int index;
@@ -337,7 +369,8 @@ int SMSStore::doInsert(SMSMessageRef message)
 
 SMSStore::SMSStore(std::string storeName, Ref<GsmAt> at, MeTa &meTa)
   throw(GsmException) :
-  _storeName(storeName), _at(at), _meTa(meTa), _useCache(true)
+  _storeName(storeName), _at(at), _meTa(meTa), _useCache(true),
+  _deleteFlags(-1)
 {
   // select SMS store
   Parser p(_meTa.setSMSStore(_storeName, true, true));
@@ -348,18 +381,28 @@ SMSStore::SMSStore(std::string storeName, Ref<GsmAt> at, MeTa &meTa)
   resizeStore(p.parseInt());    // ignore rest of line
 }
 
+void SMSStore::invalidateEntry(int index)
+{
+  // ignore indices outside of the store (eg. a bogus index 0 from the ME)
+  if (index < 0 || index >= max_size())
+    return;
+  _store[index]->_cached = false;
+}
+
 void SMSStore::resizeStore(int newSize)
 {
   int oldSize = _store.size();
   if (newSize > oldSize)
   {
     //    cout << "*** Resizing from " << oldSize << " to " << newSize << endl;
+    SMSStoreEntry *block = new SMSStoreEntry[newSize - oldSize];
+    _blocks.push_back(block);
     _store.resize(newSize);
     
     // initialize store entries
     for (int i = oldSize; i < newSize; i++)
     {
-      _store[i] = new SMSStoreEntry();
+      _store[i] = block++;
       _store[i]->_index = i;
       _store[i]->_cached = false;
       _store[i]->_mySMSStore = this;
@@ -460,7 +503,10 @@ SMSStore::iterator SMSStore::erase(iterator position)
   throw(GsmException)
 {
   eraseEntry(position->_index);
-  position->_cached = false;
+  // the slot is known to be empty now
+  position->_message = SMSMessageRef();
+  position->_status = SMSStoreEntry::Unknown;
+  position->_cached = true;
   return position + 1;
 }
 
@@ -473,16 +519,142 @@ SMSStore::iterator SMSStore::erase(iterator first, iterator last)
   return i;
 }
 
-void SMSStore::clear() throw(GsmException)
+void SMSStore::syncUnread(std::vector<iterator> &newEntries)
+  throw(GsmException)
+{
+  // select SMS store
+  _meTa.setSMSStore(_storeName, 1);
+
+  // the response consists of pairs of lines:
+  // +CMGL: <index>,<stat>,[<alpha>],<length>
+  // <pdu>
+  std::vector<std::string> lines =
+    _at->chatv("+CMGL=" + intToStr(SMSStoreEntry::ReceivedUnread), "+CMGL:");
+  for (unsigned int i = 0; i + 1 < lines.size(); i += 2)
+  {
+    Parser p(lines[i]);
+    int index = p.parseInt() - 1;
+    p.parseComma();
+    SMSStoreEntry::SMSMemoryStatus status =
+      (SMSStoreEntry::SMSMemoryStatus)p.parseInt();
+    // ignore the rest of the line
+
+    // add missing service centre address if required by ME
+    std::string pdu = lines[i + 1];
+    if (! _at->getMeTa().getCapabilities()._hasSMSSCAprefix)
+      pdu = "00" + pdu;
+
+    resizeStore(index + 1);
+    SMSStoreEntry *entry = _store[index];
+    entry->_message =
+      SMSMessage::decode(pdu,
+                         !(status == SMSStoreEntry::StoredUnsent ||
+                           status == SMSStoreEntry::StoredSent),
+                         _at.getptr());
+    entry->_status = status == SMSStoreEntry::ReceivedUnread ?
+      SMSStoreEntry::ReceivedRead : status;
+    entry->_cached = true;
+    newEntries.push_back(iterator(index, this));
+  }
+}
+
+bool SMSStore::hasDeleteFlag(int flag) throw(GsmException)
 {
+  if (_deleteFlags == -1)
+  {
+    _deleteFlags = 0;
+    try
+    {
+      // +CMGD: (<list of indices>),(<list of delflags>)
+      Parser p(_at->chat("+CMGD=?", "+CMGD:"));
+      p.parseIntSet(true);
+      if (p.parseComma(true))
+      {
+        IntSet flags = p.parseIntSet();
+        for (int i = DeleteRead; i <= DeleteAll; ++i)
+          if (flags.contains(i))
+            _deleteFlags |= 1 << i;
+      }
+    }
+    catch (GsmException &e)
+    {
+      // older MEs don't support the test command or delflags
+    }
+  }
+  return (_deleteFlags & (1 << flag)) != 0;
+}
+
+// aux function, return true if a message with status is selected by flag
+static bool selectedByDeleteFlag(SMSStoreEntry::SMSMemoryStatus status,
+                                 SMSStore::DeleteFlag flag)
+{
+  switch (flag)
+  {
+  case SMSStore::DeleteRead:
+    return status == SMSStoreEntry::ReceivedRead;
+  case SMSStore::DeleteReadAndSent:
+    return status == SMSStoreEntry::ReceivedRead ||
+      status == SMSStoreEntry::StoredSent;
+  case SMSStore::DeleteReadSentAndUnsent:
+    return status == SMSStoreEntry::ReceivedRead ||
+      status == SMSStoreEntry::StoredSent ||
+      status == SMSStoreEntry::StoredUnsent;
+  default:
+    return true;
+  }
+}
+
+void SMSStore::clear(DeleteFlag flag) throw(GsmException)
+{
+  if (hasDeleteFlag(flag))
+  {
+    _meTa.setSMSStore(_storeName, 1);
+    _at->chat("+CMGD=1," + intToStr(flag));
+
+    // cached entries with matching status are empty now, the others
+    // are unchanged
+    for (std::vector<SMSStoreEntry*>::iterator i = _store.begin();
+         i != _store.end(); ++i)
+      if (flag == DeleteAll ||
+          ((*i)->_cached && selectedByDeleteFlag((*i)->_status, flag)))
+      {
+        (*i)->_message = SMSMessageRef();
+        (*i)->_status = SMSStoreEntry::Unknown;
+        (*i)->_cached = true;
+      }
+    return;
+  }
+
+  // erase the messages one by one
   for (iterator i = begin(); i != end(); ++i)
-    erase(i);
+  {
+    SMSStoreEntry *entry = &*i;
+    if (flag == DeleteAll)
+    {
+      if (! (entry->cached() && entry->empty()))
+        erase(i);
+      continue;
+    }
+
+    SMSStoreEntry::SMSMemoryStatus status = entry->_status;
+    if (! entry->cached())
+    {
+      // the status before reading counts, reading marks unread messages
+      // as read
+      readEntry(entry->_index, entry->_message, status);
+      entry->_status = status == SMSStoreEntry::ReceivedUnread ?
+        SMSStoreEntry::ReceivedRead : status;
+      entry->_cached = true;
+    }
+    if (! entry->_message.isnull() && selectedByDeleteFlag(status, flag))
+      erase(i);
+  }
 }
 
 SMSStore::~SMSStore()
 {
-  for (std::vector<SMSStoreEntry*>::iterator i = _store.begin();
-       i != _store.end(); ++i)
-    delete *i;
+  for (std::vector<SMSStoreEntry*>::iterator i = _blocks.begin();
+       i != _blocks.end(); ++i)
+    delete[] *i;
 }
 
@@ -43,21 +43,35 @@ namespace gsmlib
     bool _cached;
     SMSStore *_mySMSStore;
     int _index;
+    std::string _pdu;           // encoded message, if read from file and
+    SMSMessage::MessageType _pduType; // not yet decoded
+
+    // read message and status from the ME or decode the message
+    // read from file, return the status reported by the ME
+    SMSMemoryStatus load() const throw(GsmException);
 
   public:
     // this constructor is only used by SMSStore
     SMSStoreEntry();
 
     // create new entry given a SMS message
-    SMSStoreEntry(SMSMessageRef message) :
+    SMSStoreEntry(const SMSMessageRef &message) :
       _message(message), _status(Unknown), _cached(true), _mySMSStore(NULL),
-      _index(0) {}
+      _index(0), _pduType(SMSMessage::SMS_DELIVER) {}
 
     // create new entry given a SMS message and an index
     // only to be used for file-based stores (see gsm_sorted_sms_store)
-    SMSStoreEntry(SMSMessageRef message, int index) :
+    SMSStoreEntry(const SMSMessageRef &message, int index) :
       _message(message), _status(Unknown), _cached(true), _mySMSStore(NULL),
-      _index(index) {}
+      _index(index), _pduType(SMSMessage::SMS_DELIVER) {}
+
+    // create new entry given an encoded SMS message, its type and an index
+    // the message is only decoded when it is accessed for the first time
+    // only to be used for file-based stores (see gsm_sorted_sms_store)
+    SMSStoreEntry(std::string pdu, SMSMessage::MessageType messageType,
+                  int index) :
+      _status(Unknown), _cached(false), _mySMSStore(NULL), _index(index),
+      _pdu(pdu), _pduType(messageType) {}
    
     // clear cached flag
     void clearCached() { _cached = false; }
@@ -65,10 +79,20 @@ namespace gsmlib
     // return SMS message stored in the entry
     SMSMessageRef message() const throw(GsmException);
 
+    // return type of the SMS message stored in the entry
+    // (does not decode messages read from file)
+    SMSMessage::MessageType messageType() const throw(GsmException);
+
+    // return SMS message stored in the entry in encoded form
+    // (does not decode and re-encode messages read from file)
+    std::string encodedMessage() const throw(GsmException);
+
     // return CB message stored in the entry
     CBMessageRef cbMessage() const throw(GsmException);
 
     // return message status in store
+    // reading a ReceivedUnread message from the ME changes its status to
+    // ReceivedRead
     SMSMemoryStatus status() const throw(GsmException);
 
     // return true if empty, ie. no SMS in this entry
@@ -105,6 +129,8 @@ namespace gsmlib
     friend class SMSStore;
   };
 
+  typedef Ref<SMSStoreEntry> SMSStoreEntryRef;
+
   // iterator for the SMSStore class
 
 #if __GNUC__ == 2 && __GNUC_MINOR__ == 95
@@ -191,17 +217,20 @@ namespace gsmlib
   {
   private:
     std::vector<SMSStoreEntry*> _store; // vector of store entries
+    std::vector<SMSStoreEntry*> _blocks; // arrays holding the entries
     std::string _storeName;          // name of the store, 2-byte like "SM"
     Ref<GsmAt> _at;             // my GsmAt class
     MeTa &_meTa;                // my MeTa class
     bool _useCache;             // true if entries should be cached
+    int _deleteFlags;           // bit mask of +CMGD delflags supported by
+                                // the ME, -1 if not yet known
 
     // internal access functions
     // read/write entry from/to ME
     void readEntry(int index, SMSMessageRef &message,
                    SMSStoreEntry::SMSMemoryStatus &status) throw(GsmException);
     void readEntry(int index, CBMessageRef &message) throw(GsmException);
-    void writeEntry(int &index, SMSMessageRef message)
+    void writeEntry(int &index, const SMSMessageRef &message)
       throw(GsmException);
     // erase entry
     void eraseEntry(int index) throw(GsmException);
@@ -212,12 +241,22 @@ namespace gsmlib
     
 
     // do the actual insertion, return index of new element
-    int doInsert(SMSMessageRef message) throw(GsmException);
+    int doInsert(const SMSMessageRef &message) throw(GsmException);
+
+    // return true if the ME supports deleting with +CMGD=1,<flag>
+    bool hasDeleteFlag(int flag) throw(GsmException);
 
     // used by class MeTa
     SMSStore(std::string storeName, Ref<GsmAt> at, MeTa &meTa) throw(GsmException);
 
+    // mark entry as not cached, it is read from the ME on the next access
+    // (called by MeTa when the ME indicates a new message in this store)
+    // indices outside of the store are ignored
+    void invalidateEntry(int index);
+
     // resize store entry vector if necessary
+    // the new entries are allocated as one array, so that the entries
+    // of the store are contiguous and keep their addresses
     void resizeStore(int newSize);
 
   public:
@@ -227,7 +266,13 @@ namespace gsmlib
     typedef SMSStoreEntry &reference;
     typedef const SMSStoreEntry &const_reference;
 
+    // message selection for clear() (delflag of +CMGD, see GSM 07.05)
+    enum DeleteFlag {DeleteRead = 1, DeleteReadAndSent = 2,
+                     DeleteReadSentAndUnsent = 3, DeleteAll = 4};
+
     // set cache mode on or off
+    // the cache is kept up to date with new messages indicated by the ME
+    // (+CMTI etc.), so there is no need to switch it off for that
     void setCaching(bool useCache) {_useCache = useCache;}
 
     // return name of this store (2-character string)
@@ -277,7 +322,18 @@ namespace gsmlib
     // erase operators set used slots to "empty"
     iterator erase(iterator position) throw(GsmException);
     iterator erase(iterator first, iterator last) throw(GsmException);
-    void clear() throw(GsmException);
+
+    // incremental synchronization: read the unread messages of the ME
+    // store (+CMGL=0) into the cache and append their positions to
+    // newEntries
+    // listing the messages marks them as read in the ME, so each message
+    // is only returned once
+    void syncUnread(std::vector<iterator> &newEntries) throw(GsmException);
+
+    // erase all messages selected by flag (by default all messages)
+    // a single +CMGD command is used if the ME supports it, otherwise the
+    // messages are erased one by one
+    void clear(DeleteFlag flag = DeleteAll) throw(GsmException);
 
     // destructor
     ~SMSStore();
@@ -21,92 +21,63 @@
 #include <fstream>
 #include <limits.h>
 #include <cstring>
-
-const int MAX_LINE_SIZE = 1000;
+#include <cstdio>
+#include <iterator>
+#include <algorithm>
+#include <vector>
+#include <errno.h>
+#ifdef HAVE_UNISTD_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 using namespace gsmlib;
 
-std::string SortedPhonebook::escapeString(std::string s)
-{
-  std::string result;
-  
-  for (const char *pp = s.c_str(); *pp != 0; ++pp)
-  {
-    if (*pp == CR)
-      result += "\\r";
-    else if (*pp == LF)
-      result += "\\n";
-    else if (*pp == '\\')
-      result += "\\\\";
-    else if (*pp == '|')
-      result += "\\|";
-    else
-      result += *pp;
-  }
-  return result;
-}
+// return the line starting at p (for error messages)
 
-std::string SortedPhonebook::unescapeString(char *line, unsigned int &pos)
+static std::string lineAt(const char *p, const char *end)
 {
-  std::string result;
-  bool escaped = false;
-
-  while (! (line[pos] == '|' && ! escaped) && line[pos] != 0 &&
-         line[pos] != CR && line[pos] != LF)
-  {
-    if (escaped)
-    {
-      escaped = false;
-      if (line[pos] == 'r')
-        result += CR;
-      else if (line[pos] == 'n')
-        result += LF;
-      else if (line[pos] == '\\')
-        result += '\\';
-      else if (line[pos] == '|')
-        result += '|';
-      else
-        result += line[pos];
-    }
-    else
-      if (line[pos] == '\\')
-        escaped = true;
-      else
-        result += line[pos];
-
-    ++pos;
-  }
-  return result;
+  const char *lineEnd = p;
+  while (lineEnd != end && *lineEnd != CR && *lineEnd != LF)
+    ++lineEnd;
+  return std::string(p, lineEnd - p);
 }
 
-void SortedPhonebook::readPhonebookFile(std::istream &pbs, std::string filename)
+void SortedPhonebook::readPhonebookFile(const char *data, size_t size,
+                                        std::string filename)
   throw(GsmException)
 {
-  // read entries
-  while (! pbs.eof())
+  const char *end = data + size;
+  const char *p = data;
+  while (p != end)
   {
-    char line[MAX_LINE_SIZE];
-    pbs.getline(line, MAX_LINE_SIZE);
-
-    if (strlen(line) == 0)
+    if (*p == CR || *p == LF)
+    {
+      ++p;
       continue;                 // skip empty lines
-
-    if (pbs.bad())
-      throw GsmException(stringPrintf(_("error reading from file '%s"),
-                                      filename.c_str()),
-                         OSError);
+    }
 
     // convert line to newEntry (line format : [index] '|' text '|' number
+    const char *line = p;
     std::string text, telephone;
-    unsigned int pos = 0;
 
     // parse index
-    std::string indexS = unescapeString(line, pos);
+    std::string indexS = unescapeString(p, end);
+    // files written by earlier versions have a 0 after the index
+    indexS.erase(std::remove(indexS.begin(), indexS.end(), 0), indexS.end());
     int index = -1;
     if (indexS.length() == 0)
     {
       if (_useIndices)
-        throw GsmException(stringPrintf(_("entry '%s' lacks index"), line),
+        throw GsmException(stringPrintf(_("entry '%s' in file '%s' "
+                                          "lacks index"),
+                                        lineAt(line, end).c_str(),
+                                        filename.c_str()),
                            ParserError);
     }
     else
@@ -114,23 +85,94 @@ void SortedPhonebook::readPhonebookFile(std::istream &pbs, std::string filename)
       index = checkNumber(indexS);
       _useIndices = true;
     }
-    if (line[pos++] != '|')
-      throw GsmException(stringPrintf(_("line '%s' has invalid format"), line),
+    if (p == end || *p++ != '|')
+      throw GsmException(stringPrintf(_("line '%s' in file '%s' has "
+                                        "invalid format"),
+                                      lineAt(line, end).c_str(),
+                                      filename.c_str()),
                          ParserError);
 
     // parse text
-    text = unescapeString(line, pos);
-    if (line[pos++] != '|')
-      throw GsmException(stringPrintf(_("line '%s' has invalid format"), line),
+    text = unescapeString(p, end);
+    if (p == end || *p++ != '|')
+      throw GsmException(stringPrintf(_("line '%s' in file '%s' has "
+                                        "invalid format"),
+                                      lineAt(line, end).c_str(),
+                                      filename.c_str()),
                          ParserError);
 
     // parse telephone number
-    telephone = unescapeString(line, pos);
+    telephone = unescapeString(p, end);
+
+    // ignore rest of line
+    while (p != end && *p != LF)
+      ++p;
 
     insert(PhonebookEntryBase(telephone, text, index));
   }
 }
 
+void SortedPhonebook::readPhonebookFile(std::istream &pbs, std::string filename)
+  throw(GsmException)
+{
+  std::string data;
+  char buf[65536];
+  while (pbs.read(buf, sizeof(buf)), pbs.gcount() > 0)
+    data.append(buf, pbs.gcount());
+
+  if (pbs.bad())
+    throw GsmException(stringPrintf(_("error reading from file '%s"),
+                                    filename.c_str()),
+                       OSError);
+
+  readPhonebookFile(data.data(), data.length(), filename);
+}
+
+bool SortedPhonebook::readMappedPhonebookFile(std::string filename)
+  throw(GsmException)
+{
+#ifdef HAVE_MMAP
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    return false;
+
+  struct stat statBuf;
+  if (fstat(fd, &statBuf) == -1 || ! S_ISREG(statBuf.st_mode))
+  {
+    close(fd);
+    return false;
+  }
+  if (statBuf.st_size == 0)     // nothing to map
+  {
+    close(fd);
+    return true;
+  }
+
+  size_t size = statBuf.st_size;
+  void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+#ifdef MADV_SEQUENTIAL
+  madvise(data, size, MADV_SEQUENTIAL);
+#endif
+
+  try
+  {
+    readPhonebookFile((const char*)data, size, filename);
+  }
+  catch (GsmException &e)
+  {
+    munmap(data, size);
+    throw;
+  }
+  munmap(data, size);
+  return true;
+#else
+  return false;
+#endif
+}
+
 void SortedPhonebook::sync(bool fromDestructor) throw(GsmException)
 {
   // if not in file it already is stored in ME/TA
@@ -152,56 +194,43 @@ void SortedPhonebook::sync(bool fromDestructor) throw(GsmException)
   if (_changed)
   {
     checkReadonly();
-    // create backup file - but only once
-    if (! _madeBackupFile && _filename != "") // don't make backup of stdout
+
+    // convert entries to output lines
+    std::string buffer;
+    for (PhonebookMap::iterator i = currentIndex().begin();
+         i != currentIndex().end(); ++i)
     {
-      renameToBackupFile(_filename);
-      _madeBackupFile = true;
+      if (_useIndices)
+        buffer += stringPrintf("%d", i->second->index());
+      buffer += '|';
+      buffer += escapeString(i->second->text());
+      buffer += '|';
+      buffer += escapeString(i->second->telephone());
+      buffer += '\n';
     }
 
-    // open stream
-    std::ostream *pbs = NULL;
-    try
+    if (_filename == "")
     {
-      if (_filename == "")
-        pbs = &std::cout;
-      else
-        pbs = new std::ofstream(_filename.c_str());
-      
-      if (pbs->bad())
+      std::cout.write(buffer.data(), buffer.length());
+      std::cout.flush();
+      if (! std::cout)
         throw GsmException(
-          stringPrintf(_("error opening file '%s' for writing"),
-                       (_filename == "" ? _("<STDOUT>") :
-                        _filename.c_str())),
+          stringPrintf(_("error writing to file '%s'"), _("<STDOUT>")),
           OSError);
-    
-      // and write the entries
-      for (PhonebookMap::iterator i = _sortedPhonebook.begin();
-           i != _sortedPhonebook.end(); ++i)
-      {
-        // convert entry to output line
-        std::string line =
-          (_useIndices ? intToStr(i->second->index()) : "") + "|" +
-          escapeString(i->second->text()) + "|" +
-          escapeString(i->second->telephone());
-      
-        // write out the line
-        *pbs << line << std::endl;
-        if (pbs->bad())
-          throw GsmException(
-            stringPrintf(_("error writing to file '%s'"),
-                         (_filename == "" ? _("<STDOUT>") :
-                          _filename.c_str())),
-            OSError);
-      }
     }
-    catch(GsmException &e)
+    else
     {
-      if (pbs != &std::cout) delete pbs;
-      throw;
+      // create backup file - but only once
+      if (! _madeBackupFile)
+      {
+        makeBackupFile(_filename);
+        _madeBackupFile = true;
+      }
+
+      // the entries are written to a new file that replaces the old one
+      // when it is complete and on disk
+      replaceFile(_filename, _filename + ".new", buffer);
     }
-    // close file
-    if (pbs != &std::cout) delete pbs;
 
     // reset all changed states
     _changed = false;
@@ -223,6 +252,12 @@ SortedPhonebook::SortedPhonebook(std::string filename, bool useIndices)
   _sortOrder(ByIndex), _useIndices(useIndices), _readonly(false),
   _filename(filename)
 {
+  for (int i = 0; i < SORT_ORDER_COUNT; ++i)
+    _indexBuilt[i] = (i == _sortOrder);
+
+  if (readMappedPhonebookFile(filename))
+    return;
+
   // open the file
   std::ifstream pbs(filename.c_str());
   if (pbs.bad())
@@ -239,6 +274,9 @@ SortedPhonebook::SortedPhonebook(bool fromStdin, bool useIndices)
   _sortOrder(ByIndex), _useIndices(useIndices), _readonly(fromStdin)
   // _filename is "" - this means stdout
 {
+  for (int i = 0; i < SORT_ORDER_COUNT; ++i)
+    _indexBuilt[i] = (i == _sortOrder);
+
   // read from stdin
   if (fromStdin)
     readPhonebookFile(std::cin, (std::string)_("<STDIN>"));
@@ -249,6 +287,9 @@ SortedPhonebook::SortedPhonebook(PhonebookRef mePhonebook)
   _changed(false), _fromFile(false), _madeBackupFile(false),
   _sortOrder(ByIndex), _readonly(false), _mePhonebook(mePhonebook)
 {
+  for (int i = 0; i < SORT_ORDER_COUNT; ++i)
+    _indexBuilt[i] = (i == _sortOrder);
+
   int entriesRead = 0;
   reportProgress(0, _mePhonebook->end() - _mePhonebook->begin());
 
@@ -257,8 +298,7 @@ SortedPhonebook::SortedPhonebook(PhonebookRef mePhonebook)
   {
     if (! i->empty())
     {
-      _sortedPhonebook.insert(
-        PhonebookMap::value_type(PhoneMapKey(*this, lowercase(i->text())), i));
+      indexEntry(i);
       ++entriesRead;
       if (entriesRead == _mePhonebook->size())
         return;                 // ready
@@ -267,50 +307,99 @@ SortedPhonebook::SortedPhonebook(PhonebookRef mePhonebook)
   }
 }
 
-void SortedPhonebook::setSortOrder(SortOrder newOrder)
+PhoneMapKey SortedPhonebook::entryKey(SortOrder sortOrder,
+                                      PhonebookEntryBase *entry)
 {
-  if (newOrder == _sortOrder) return; // nothing to do
-
-  PhonebookMap savedPhonebook = _sortedPhonebook; // save phonebook
-  _sortedPhonebook = PhonebookMap(); // empty old phonebook
-  _sortOrder = newOrder;
-
-  // re-insert entries
-  switch (newOrder)
+  switch (sortOrder)
   {
   case ByTelephone:
-  {
-    for (PhonebookMap::iterator i = savedPhonebook.begin();
-         i != savedPhonebook.end(); ++i)
-      _sortedPhonebook.
-        insert(PhonebookMap::value_type(
-          PhoneMapKey(*this, lowercase(i->second->telephone())), i->second));
-    break;
-  }
+    return PhoneMapKey(*this, sortOrder, lowercase(entry->telephone()));
   case ByText:
-  {
-    for (PhonebookMap::iterator i = savedPhonebook.begin();
-         i != savedPhonebook.end(); ++i)
-      _sortedPhonebook.
-        insert(PhonebookMap::value_type(
-          PhoneMapKey(*this, lowercase(i->second->text())), i->second));
-    break;
-  }
+    return PhoneMapKey(*this, sortOrder, lowercase(entry->text()));
   case ByIndex:
-  {
-    for (PhonebookMap::iterator i = savedPhonebook.begin();
-         i != savedPhonebook.end(); ++i)
-      _sortedPhonebook.
-        insert(PhonebookMap::value_type(
-          PhoneMapKey(*this, i->second->index()), i->second));
-    break;
-  }
+    return PhoneMapKey(*this, sortOrder, entry->index());
   default:
     assert(0);
-    break;
+    return PhoneMapKey(*this, sortOrder, 0);
   }
 }
 
+PhonebookMap &SortedPhonebook::index(SortOrder sortOrder)
+{
+  if (! _indexBuilt[sortOrder])
+  {
+    // build the new index from the current one
+    PhonebookMap &newIndex = _sortedPhonebook[sortOrder];
+    newIndex.clear();
+    for (PhonebookMap::iterator i = currentIndex().begin();
+         i != currentIndex().end(); ++i)
+      newIndex.insert(PhonebookMap::value_type(entryKey(sortOrder, i->second),
+                                               i->second));
+    _indexBuilt[sortOrder] = true;
+  }
+  return _sortedPhonebook[sortOrder];
+}
+
+SortedPhonebook::iterator
+SortedPhonebook::indexEntry(PhonebookEntryBase *entry)
+{
+  iterator result;
+  for (int o = 0; o < SORT_ORDER_COUNT; ++o)
+    if (_indexBuilt[o])
+    {
+      PhonebookMap::iterator i =
+        _sortedPhonebook[o].insert(
+          PhonebookMap::value_type(entryKey((SortOrder)o, entry), entry));
+      if (o == _sortOrder)
+        result = i;
+    }
+  return result;
+}
+
+void SortedPhonebook::unindexEntry(PhonebookEntryBase *entry)
+{
+  for (int o = 0; o < SORT_ORDER_COUNT; ++o)
+    if (_indexBuilt[o])
+    {
+      PhonebookMap &sortedIndex = _sortedPhonebook[o];
+      std::pair<PhonebookMap::iterator, PhonebookMap::iterator> range =
+        sortedIndex.equal_range(entryKey((SortOrder)o, entry));
+      PhonebookMap::iterator i;
+      for (i = range.first; i != range.second; ++i)
+        if (i->second == entry)
+          break;
+      // the key may have changed after insertion, search all entries then
+      if (i == range.second)
+        for (i = sortedIndex.begin(); i != sortedIndex.end(); ++i)
+          if (i->second == entry)
+            break;
+      assert(i != sortedIndex.end());
+      sortedIndex.erase(i);
+    }
+}
+
+void SortedPhonebook::eraseEntry(PhonebookEntryBase *entry)
+  throw(GsmException)
+{
+  checkReadonly();
+  _changed = true;
+  unindexEntry(entry);
+
+  // deallocate memory or remove from underlying ME phonebook
+  if (_fromFile)
+    delete entry;
+  else
+    _mePhonebook->erase((Phonebook::iterator)entry);
+}
+
+void SortedPhonebook::setSortOrder(SortOrder newOrder)
+{
+  if (newOrder == _sortOrder) return; // nothing to do
+
+  index(newOrder);
+  _sortOrder = newOrder;
+}
+
 unsigned int SortedPhonebook::getMaxTelephoneLen() const
 {
   if (_fromFile)
@@ -330,7 +419,7 @@ unsigned int SortedPhonebook::getMaxTextLen() const
 int SortedPhonebook::max_size() const
 {
   if (_fromFile)
-    return _sortedPhonebook.max_size();
+    return currentIndex().max_size();
   else
     return _mePhonebook->max_size();
 }
@@ -338,7 +427,7 @@ int SortedPhonebook::max_size() const
 int SortedPhonebook::capacity() const
 {
   if (_fromFile)
-    return _sortedPhonebook.max_size();
+    return currentIndex().max_size();
   else
     return _mePhonebook->capacity();
 }
@@ -353,25 +442,22 @@ SortedPhonebook::insert(const PhonebookEntryBase& x) throw(GsmException)
   if (_fromFile)
     if (_useIndices)
     {
+      PhonebookMap &byIndex = index(ByIndex);
       if (x.index() != -1)      // check that index is unique
       {
-        for (PhonebookMap::iterator i = _sortedPhonebook.begin();
-             i != _sortedPhonebook.end(); ++i)
-          if (i->second->index() == x.index())
-            throw GsmException(_("indices must be unique in phonebook"),
-                               ParameterError);
+        if (byIndex.find(PhoneMapKey(*this, ByIndex, x.index())) !=
+            byIndex.end())
+          throw GsmException(_("indices must be unique in phonebook"),
+                             ParameterError);
         newEntry = new PhonebookEntryBase(x);
       }
       else                      // set index
       {
-        SortOrder saveSortOrder = _sortOrder;
-        setSortOrder(ByIndex);
         int index = 0;
-        for (PhonebookMap::iterator i = _sortedPhonebook.begin();
-             i != _sortedPhonebook.end(); ++i, ++index)
+        for (PhonebookMap::iterator i = byIndex.begin();
+             i != byIndex.end(); ++i, ++index)
           if (i->second->index() != index)
             break;
-        setSortOrder(saveSortOrder);
         newEntry = new PhonebookEntryBase();
         newEntry->set(x.telephone(), x.text(), index, true);
       }
@@ -383,28 +469,7 @@ SortedPhonebook::insert(const PhonebookEntryBase& x) throw(GsmException)
     PhonebookEntry newMEEntry(x);
     newEntry = _mePhonebook->insert((PhonebookEntry*)NULL, newMEEntry);
   }
-  switch (_sortOrder)
-  {
-  case ByTelephone:
-    return
-      _sortedPhonebook.
-      insert(PhonebookMap::value_type(
-        PhoneMapKey(*this, lowercase(newEntry->telephone())), newEntry));
-  case ByText:
-    return
-      _sortedPhonebook.
-      insert(PhonebookMap::value_type(
-        PhoneMapKey(*this, lowercase(newEntry->text())), newEntry));
-  case ByIndex:
-    return
-      _sortedPhonebook.
-      insert(PhonebookMap::value_type(
-        PhoneMapKey(*this, newEntry->index()), newEntry));
-  default:
-    assert(0);
-    break;
-  }
-  return SortedPhonebook::iterator();
+  return indexEntry(newEntry);
 }
 
 SortedPhonebook::iterator
@@ -414,80 +479,69 @@ SortedPhonebook::insert(iterator position, const PhonebookEntryBase& x)
   return insert(x);
 }
 
-SortedPhonebook::size_type SortedPhonebook::erase(std::string &key)
+SortedPhonebook::iterator
+SortedPhonebook::replace(iterator position, const PhonebookEntryBase& x)
   throw(GsmException)
 {
-  // deallocate memory or remove from underlying ME phonebook
-  for (PhonebookMap::iterator i =
-         _sortedPhonebook.find(PhoneMapKey(*this, lowercase(key)));
-       i != _sortedPhonebook.end() &&
-         i->first == PhoneMapKey(*this, lowercase(key));
-       ++i)
+  checkReadonly();
+  _changed = true;
+  PhonebookEntryBase *entry = ((PhonebookMap::iterator)position)->second;
+
+  // the keys may change, so take the entry out of the indices first
+  unindexEntry(entry);
+  try
   {
-    checkReadonly();
-    _changed = true;
-    if (_fromFile)
-      delete i->second;
-    else
-      _mePhonebook->erase((Phonebook::iterator)i->second);
+    *entry = x;
+  }
+  catch (GsmException &e)
+  {
+    indexEntry(entry);
+    throw;
   }
+  return indexEntry(entry);
+}
 
-  return _sortedPhonebook.erase(PhoneMapKey(*this, lowercase(key)));
+SortedPhonebook::size_type SortedPhonebook::erase(std::string &key)
+  throw(GsmException)
+{
+  std::pair<iterator, iterator> range = equal_range(key);
+  size_type result = std::distance(range.first, range.second);
+  erase(range.first, range.second);
+  return result;
 }
 
 SortedPhonebook::size_type SortedPhonebook::erase(int key)
   throw(GsmException)
 {
-  // deallocate memory or remove from underlying ME phonebook
-  for (PhonebookMap::iterator i =
-         _sortedPhonebook.find(PhoneMapKey(*this, key));
-       i != _sortedPhonebook.end() && i->first == PhoneMapKey(*this, key);
-       ++i)
-  {
-    checkReadonly();
-    _changed = true;
-    if (_fromFile)
-      delete i->second;
-    else
-      _mePhonebook->erase((Phonebook::iterator)i->second);
-  }
-
-  return _sortedPhonebook.erase(PhoneMapKey(*this, key));
+  std::pair<iterator, iterator> range = equal_range(key);
+  size_type result = std::distance(range.first, range.second);
+  erase(range.first, range.second);
+  return result;
 }
 
 void SortedPhonebook::erase(iterator position)
   throw(GsmException)
 {
-  checkReadonly();
-  _changed = true;
-  // deallocate memory or remove from underlying ME phonebook
-  if (_fromFile)
-    delete ((PhonebookMap::iterator)position)->second;
-  else
-    _mePhonebook->erase((Phonebook::iterator)
-                        ((PhonebookMap::iterator)position)->second);
-  _sortedPhonebook.erase(position);
+  eraseEntry(((PhonebookMap::iterator)position)->second);
 }
 
 void SortedPhonebook::erase(iterator first, iterator last)
   throw(GsmException)
 {
-  checkReadonly();
-  _changed = true;
+  // collect entries first, erasing invalidates the iterators
+  std::vector<PhonebookEntryBase*> entries;
   for (PhonebookMap::iterator i = first; i != last; ++i)
-    if (_fromFile)
-      delete i->second;
-    else
-      _mePhonebook->erase((Phonebook::iterator)i->second);
-  _sortedPhonebook.erase(first, last);
+    entries.push_back(i->second);
+  for (std::vector<PhonebookEntryBase*>::iterator j = entries.begin();
+       j != entries.end(); ++j)
+    eraseEntry(*j);
 }
 
 void SortedPhonebook::clear() throw(GsmException)
 {
   checkReadonly();
   _changed = true;
-  for (iterator i = begin(); i != end(); i++)
-    erase(i);
+  erase(begin(), end());
 }
 
 SortedPhonebook::~SortedPhonebook()
@@ -495,8 +549,8 @@ SortedPhonebook::~SortedPhonebook()
   if (_fromFile)
   {
     sync(true);
-    for (PhonebookMap::iterator i = _sortedPhonebook.begin();
-         i != _sortedPhonebook.end(); ++i)
+    for (PhonebookMap::iterator i = currentIndex().begin();
+         i != currentIndex().end(); ++i)
       delete i->second;
   }
 }
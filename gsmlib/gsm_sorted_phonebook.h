@@ -28,6 +28,13 @@ namespace gsmlib
   // The class SortedPhonebook makes the phonebook more manageable:
   // - empty slots in the ME phonebook are hidden by the API
   // - the class transparently handles phonebooks that reside in files
+  // - one index (multimap) is kept per sort order; an index is built
+  //   the first time its sort order is used and is updated incrementally
+  //   by insert() and erase() afterwards, so switching between sort orders
+  //   is cheap
+  //   Note: entries changed in place (eg. by PhonebookEntryBase::set())
+  //   keep their position in all indices that already exist, use
+  //   replace() to change an entry and re-sort it
 
   class SortedPhonebook : public SortedPhonebookBase
   {
@@ -40,25 +47,49 @@ namespace gsmlib
                                 // indices; will write indices, too
     bool _readonly;             // =true if read from stdin
     std::string _filename;           // name of the file if phonebook from file
-    PhonebookMap _sortedPhonebook; // phonebook from file
+    PhonebookMap _sortedPhonebook[SORT_ORDER_COUNT]; // one index per
+                                // sort order (ByText, ByTelephone, ByIndex)
+    bool _indexBuilt[SORT_ORDER_COUNT]; // true if index is up to date
     PhonebookRef _mePhonebook;  // phonebook if from ME
 
-    // convert CR and LF in string to "\r" and "\n" respectively
-    std::string escapeString(std::string s);
-
-    // convert "\r" and "\n" to CR and LF respectively
-    // start parsing with pos, stop when CR, LF, 0, or '|' is encountered
-    std::string unescapeString(char *line, unsigned int &pos);
-
     // initial read of phonebook file
+    // the data version parses the file contents in place, the stream
+    // version reads the entire stream first
+    void readPhonebookFile(const char *data, size_t size,
+                           std::string filename) throw(GsmException);
     void readPhonebookFile(std::istream &pbs, std::string filename) throw(GsmException);
 
+    // read phonebook file through mmap, return false if this is not
+    // possible
+    bool readMappedPhonebookFile(std::string filename) throw(GsmException);
+
     // synchronize SortedPhonebook with file (no action if in ME)
     void sync(bool fromDestructor) throw(GsmException);
     
     // throw an exception if _readonly is set
     void checkReadonly() throw(GsmException);
 
+    // return index for the current sort order
+    PhonebookMap &currentIndex() {return _sortedPhonebook[_sortOrder];}
+    const PhonebookMap &currentIndex() const
+      {return _sortedPhonebook[_sortOrder];}
+
+    // return index for sortOrder, build it first if necessary
+    PhonebookMap &index(SortOrder sortOrder);
+
+    // return key of entry for given sort order
+    PhoneMapKey entryKey(SortOrder sortOrder, PhonebookEntryBase *entry);
+
+    // add entry to all built indices, return position in current index
+    SortedPhonebookIterator indexEntry(PhonebookEntryBase *entry);
+
+    // remove entry from all built indices
+    void unindexEntry(PhonebookEntryBase *entry);
+
+    // remove entry from all built indices, then deallocate it or remove it
+    // from the underlying ME phonebook
+    void eraseEntry(PhonebookEntryBase *entry) throw(GsmException);
+
   public:
     // iterator defs
     typedef SortedPhonebookIterator iterator;
@@ -92,11 +123,11 @@ namespace gsmlib
     // that may either be empty or used
     
     // traversal commands
-    iterator begin() {return _sortedPhonebook.begin();}
-    iterator end() {return _sortedPhonebook.end();}
+    iterator begin() {return currentIndex().begin();}
+    iterator end() {return currentIndex().end();}
 
     // the size macros return the number of used entries
-    int size() const {return _sortedPhonebook.size();}
+    int size() const {return currentIndex().size();}
     int max_size() const;
     int capacity() const;
     bool empty() const throw(GsmException) {return size() == 0;}
@@ -112,31 +143,43 @@ namespace gsmlib
     iterator insert(iterator position, const PhonebookEntryBase& x)
       throw(GsmException);
 
+    // overwrite the entry at position, the entry is moved to its new
+    // place in all built indices
+    iterator replace(iterator position, const PhonebookEntryBase& x)
+      throw(GsmException);
+
+    // string keys are looked up in the index of the current sort order
+    // (ByText or ByTelephone)
     PhonebookMap::size_type count(std::string &key)
-      {return _sortedPhonebook.count(PhoneMapKey(*this, lowercase(key)));}
+      {return currentIndex().count(PhoneMapKey(*this, lowercase(key)));}
     iterator find(std::string &key)
-      {return _sortedPhonebook.find(PhoneMapKey(*this, lowercase(key)));}
+      {return currentIndex().find(PhoneMapKey(*this, lowercase(key)));}
     iterator lower_bound(std::string &key)
-      {return _sortedPhonebook.lower_bound(PhoneMapKey(*this,
-                                                       lowercase(key)));}
+      {return currentIndex().lower_bound(PhoneMapKey(*this,
+                                                     lowercase(key)));}
     iterator upper_bound(std::string &key)
-      {return _sortedPhonebook.upper_bound(PhoneMapKey(*this,
-                                                       lowercase(key)));}
+      {return currentIndex().upper_bound(PhoneMapKey(*this,
+                                                     lowercase(key)));}
     std::pair<iterator, iterator> equal_range(std::string &key)
-      {return _sortedPhonebook.equal_range(PhoneMapKey(*this,
-                                                       lowercase(key)));}
+      {return currentIndex().equal_range(PhoneMapKey(*this,
+                                                     lowercase(key)));}
 
+    // count() and equal_range() for int keys use the ByIndex index
+    // regardless of the current sort order, the other lookup functions
+    // require the ByIndex sort order because their result is compared
+    // against end()
     PhonebookMap::size_type count(int key)
-      {return _sortedPhonebook.count(PhoneMapKey(*this, key));}
+      {return index(ByIndex).count(PhoneMapKey(*this, ByIndex, key));}
     iterator find(int key)
-      {return _sortedPhonebook.find(PhoneMapKey(*this, key));}
+      {return currentIndex().find(PhoneMapKey(*this, key));}
     iterator lower_bound(int key)
-      {return _sortedPhonebook.lower_bound(PhoneMapKey(*this, key));}
+      {return currentIndex().lower_bound(PhoneMapKey(*this, key));}
     iterator upper_bound(int key)
-      {return _sortedPhonebook.upper_bound(PhoneMapKey(*this, key));}
+      {return currentIndex().upper_bound(PhoneMapKey(*this, key));}
     std::pair<iterator, iterator> equal_range(int key)
-      {return _sortedPhonebook.equal_range(PhoneMapKey(*this, key));}
+      {return index(ByIndex).equal_range(PhoneMapKey(*this, ByIndex, key));}
 
+    // erase functions accept iterators into any of the indices
     size_type erase(std::string &key) throw(GsmException);
     size_type erase(int key) throw(GsmException);
     void erase(iterator position) throw(GsmException);
@@ -155,6 +155,12 @@ namespace gsmlib
     virtual iterator insert(iterator position, const PhonebookEntryBase& x)
       throw(GsmException) = 0;
 
+    // overwrite the entry at position with the contents of x and return
+    // its new position (the entry is re-sorted if its key changes)
+    // position is invalid afterwards, other iterators remain valid
+    virtual iterator replace(iterator position, const PhonebookEntryBase& x)
+      throw(GsmException) {*position = x; return position;}
+
     virtual PhonebookMap::size_type count(std::string &key) = 0;
     virtual iterator find(std::string &key) = 0;
     virtual iterator lower_bound(std::string &key) = 0;
@@ -16,11 +16,22 @@
 #include <gsmlib/gsm_nls.h>
 #include <gsmlib/gsm_sysdep.h>
 #include <gsmlib/gsm_sorted_sms_store.h>
+#include <gsmlib/gsm_sms_search_index.h>
 #include <iostream>
 #include <fstream>
 #include <cstring>
-#ifdef HAVE_NETINET_IN_H
-#include <netinet/in.h>
+#include <iterator>
+#include <errno.h>
+#include <vector>
+#include <set>
+#ifdef HAVE_UNISTD_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
 #endif
 
 using namespace gsmlib;
@@ -38,8 +49,36 @@ using namespace gsmlib;
 //    1 SMS_SUBMIT
 //    2 SMS_STATUS_REPORT
 // 4. PDU in hexadecimal format
+//
+// version 2 of the format is an append-only journal, the version number
+// is followed by a sequence of records:
+// 1. record type (1 byte): 0 message, 1 tombstone (message was erased)
+// 2. length of the record data (see 4. below): unsigned short int,
+//    2 bytes in network byte order
+// 3. identifier of the message, unique for this file: unsigned long,
+//    4 bytes in network byte order
+// 4. record data: MessageType (1 byte, see above) followed by the PDU in
+//    hexadecimal format for messages, empty for tombstones
+// 5. CRC-32 checksum of 1. to 4.: unsigned long,
+//    4 bytes in network byte order
+// a record that extends beyond the end of the file is the remainder of an
+// interrupted append, it is ignored and overwritten by the next append
 
 static const unsigned short int SMS_STORE_FILE_FORMAT_VERSION = 1;
+static const unsigned short int SMS_STORE_JOURNAL_FORMAT_VERSION = 2;
+
+// journal record types
+static const char JOURNAL_MESSAGE = 0;
+static const char JOURNAL_TOMBSTONE = 1;
+
+// size of the journal record header (items 1. to 3. above) and checksum
+static const unsigned int JOURNAL_HEADER_SIZE = 7;
+static const unsigned int JOURNAL_CHECKSUM_SIZE = 4;
+
+// the journal is compacted by sync() if it contains at least this many
+// dead records (erased messages and their tombstones) and more dead
+// records than messages
+static const unsigned int JOURNAL_MIN_DEAD_RECORDS = 64;
 
 // SortedSMSStore members
 
@@ -68,10 +107,116 @@ static void writenbytes(std::string &filename, std::ostream &os,
                                      filename.c_str())), OSError);
 }
 
+#ifdef HAVE_UNISTD_H
+// aux function write all bytes to fd, return false on error
+static bool writeAll(int fd, const char *p, size_t len)
+{
+  while (len > 0)
+  {
+    ssize_t written = write(fd, p, len);
+    if (written == -1)
+    {
+      if (errno != EINTR)
+        return false;
+    }
+    else
+    {
+      p += written;
+      len -= written;
+    }
+  }
+  return true;
+}
+#endif
+
+// aux functions to decode integers in network byte order
+static unsigned int getUnsignedShort(const char *buf)
+{
+  return ((unsigned char)buf[0] << 8) | (unsigned char)buf[1];
+}
+
+static unsigned_int_4 getUnsignedLong(const char *buf)
+{
+  return ((unsigned_int_4)getUnsignedShort(buf) << 16) |
+    getUnsignedShort(buf + 2);
+}
+
+// aux functions to encode integers in network byte order
+static void putUnsignedShort(char *buf, unsigned int value)
+{
+  buf[0] = (value >> 8) & 0xff;
+  buf[1] = value & 0xff;
+}
+
+static void putUnsignedLong(char *buf, unsigned_int_4 value)
+{
+  putUnsignedShort(buf, (value >> 16) & 0xffff);
+  putUnsignedShort(buf + 2, value & 0xffff);
+}
+
+// aux function to create a journal record
+static std::string journalRecord(char recordType, unsigned_int_4 id,
+                                 std::string data)
+{
+  char buf[JOURNAL_HEADER_SIZE];
+  buf[0] = recordType;
+  putUnsignedShort(buf + 1, data.length());
+  putUnsignedLong(buf + 3, id);
+  std::string result = std::string(buf, JOURNAL_HEADER_SIZE) + data;
+
+  putUnsignedLong(buf, gsmlib::crc32(result.data(), result.length()));
+  return result + std::string(buf, JOURNAL_CHECKSUM_SIZE);
+}
+
+// aux function to create the journal record for a message
+static std::string journalRecord(SMSStoreEntry *entry) throw(GsmException)
+{
+  return journalRecord(JOURNAL_MESSAGE, entry->index(),
+                       (char)entry->messageType() + entry->encodedMessage());
+}
+
+// aux function to check the version number at the start of the file
+static void checkVersion(std::string &filename, const char *buf)
+  throw(GsmException)
+{
+  if (getUnsignedShort(buf) != SMS_STORE_FILE_FORMAT_VERSION)
+    throw GsmException(stringPrintf(_("file '%s' has wrong version"),
+                                    filename.c_str()), ParameterError);
+}
+
+// maximum length of PDU in file
+static const unsigned int SMS_STORE_MAX_PDU_LENGTH = 500;
+
+// aux function to check the header of a message (items 1. to 3. above)
+// return the length of the PDU
+static unsigned int checkRecordHeader(std::string &filename, const char *buf)
+  throw(GsmException)
+{
+  unsigned int pduLen = getUnsignedShort(buf);
+  // the reserved field (was formerly index) in buf[2..5] is ignored
+  if (pduLen > SMS_STORE_MAX_PDU_LENGTH || (unsigned char)buf[6] > 2)
+    throw GsmException(stringPrintf(_("corrupt SMS store file '%s'"),
+                                    filename.c_str()), ParameterError);
+  return pduLen;
+}
+
+// size of the header of a message (items 1. to 3. above)
+static const unsigned int SMS_STORE_RECORD_HEADER_SIZE = 7;
+
+void SortedSMSStore::addFileEntry(const char *header, const char *pdu)
+{
+  // the message is only decoded when it is accessed for the first time,
+  // the ByIndex index does not need it
+  indexEntry(new SMSStoreEntry(std::string(pdu, getUnsignedShort(header)),
+                               (SMSMessage::MessageType)header[6],
+                               _nextIndex++));
+}
+
 void SortedSMSStore::readSMSFile(std::istream &pbs, std::string filename)
   throw(GsmException)
 {
-  char numberBuf[4];
+  char numberBuf[SMS_STORE_RECORD_HEADER_SIZE];
+  char pduBuf[SMS_STORE_MAX_PDU_LENGTH];
 
   // check the version
   try
@@ -82,12 +227,21 @@ void SortedSMSStore::readSMSFile(std::istream &pbs, std::string filename)
     {
       // ignore error, file might be empty initially
     }
-  unsigned_int_2 version;
-  memcpy(&version, numberBuf, sizeof(*numberBuf));
-  version = ntohs(version);
-  if (!pbs.eof() && version != SMS_STORE_FILE_FORMAT_VERSION)
-    throw GsmException(stringPrintf(_("file '%s' has wrong version"),
-                                    filename.c_str()), ParameterError);
+  if (pbs.eof())
+    return;
+  if (getUnsignedShort(numberBuf) == SMS_STORE_JOURNAL_FORMAT_VERSION)
+  {
+    // read the rest of the journal into memory
+    std::string journal((std::istreambuf_iterator<char>(pbs)),
+                        std::istreambuf_iterator<char>());
+    if (pbs.bad())
+      throw GsmException(stringPrintf(_("error reading from file '%s'"),
+                                      filename.c_str()), OSError);
+    readJournal(journal.data(), journal.length(), filename);
+    return;
+  }
+  checkVersion(filename, numberBuf);
+  _journal = false;
 
   // read entries
   while (1)
@@ -96,45 +250,207 @@ void SortedSMSStore::readSMSFile(std::istream &pbs, std::string filename)
       if (! readnbytes(filename, pbs, 2, numberBuf, false))
 	break;
 
-      unsigned_int_2 pduLen;
-      memcpy(&pduLen, numberBuf, sizeof(*numberBuf));
-      pduLen = ntohs(pduLen);
+      // read reserved field and message type
+      readnbytes(filename, pbs, SMS_STORE_RECORD_HEADER_SIZE - 2,
+                 numberBuf + 2);
+      unsigned int pduLen = checkRecordHeader(filename, numberBuf);
 
-      if (pduLen > 500)
-	throw GsmException(stringPrintf(_("corrupt SMS store file '%s'"),
-					filename.c_str()), ParameterError);
+      // read pdu
+      readnbytes(filename, pbs, pduLen, pduBuf);
+      addFileEntry(numberBuf, pduBuf);
+    }
+}
 
-      // read reserved integer field of message (was formerly index)
-      readnbytes(filename, pbs, 4, numberBuf);
-      //unsigned_int_4 reserved = ntohl(*((unsigned_int_4*)numberBuf));
-    
-      // read message type
-      readnbytes(filename, pbs, 1, numberBuf);
-      SMSMessage::MessageType messageType =
-	(SMSMessage::MessageType)numberBuf[0];
-      if (messageType > 2)
-	throw GsmException(stringPrintf(_("corrupt SMS store file '%s'"),
-					filename.c_str()), ParameterError);
+void SortedSMSStore::readSMSFile(const char *data, size_t size,
+                                 std::string filename) throw(GsmException)
+{
+  // check the version, ignore file that is empty initially
+  if (size < 2)
+    return;
+  if (getUnsignedShort(data) == SMS_STORE_JOURNAL_FORMAT_VERSION)
+  {
+    readJournal(data + 2, size - 2, filename);
+    return;
+  }
+  checkVersion(filename, data);
+  _journal = false;
 
-      char *pduBuf = (char*)alloca(sizeof(char) * pduLen);
+  // walk the messages in place
+  const char *end = data + size;
+  for (const char *p = data + 2; p != end;)
+  {
+    if ((size_t)(end - p) < SMS_STORE_RECORD_HEADER_SIZE)
+      throw GsmException(stringPrintf(_("error reading from file '%s'"),
+                                      filename.c_str()), OSError);
+    unsigned int pduLen = checkRecordHeader(filename, p);
+    if ((size_t)(end - p) < SMS_STORE_RECORD_HEADER_SIZE + pduLen)
+      throw GsmException(stringPrintf(_("error reading from file '%s'"),
+                                      filename.c_str()), OSError);
+    addFileEntry(p, p + SMS_STORE_RECORD_HEADER_SIZE);
+    p += SMS_STORE_RECORD_HEADER_SIZE + pduLen;
+  }
+}
 
-      // read pdu
-      readnbytes(filename, pbs, pduLen, pduBuf);
-      SMSMessageRef message =
-	SMSMessage::decode(std::string(pduBuf, pduLen),
-			   (messageType != SMSMessage::SMS_SUBMIT));
-    
-      SMSStoreEntry *newEntry = new SMSStoreEntry(message, _nextIndex++);
-      _sortedSMSStore.insert(
-			     SMSStoreMap::value_type(
-						     SMSMapKey(*this, message->serviceCentreTimestamp()),
-						     newEntry)
-			     );
+bool SortedSMSStore::readMappedSMSFile(std::string filename)
+  throw(GsmException)
+{
+#ifdef HAVE_MMAP
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    return false;
+
+  struct stat statBuf;
+  if (fstat(fd, &statBuf) == -1 || ! S_ISREG(statBuf.st_mode))
+  {
+    close(fd);
+    return false;
+  }
+  if (statBuf.st_size == 0)     // nothing to map
+  {
+    close(fd);
+    return true;
+  }
+
+  size_t size = statBuf.st_size;
+  void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+#ifdef MADV_SEQUENTIAL
+  madvise(data, size, MADV_SEQUENTIAL);
+#endif
+
+  try
+  {
+    readSMSFile((const char*)data, size, filename);
+  }
+  catch (GsmException &e)
+  {
+    munmap(data, size);
+    throw;
+  }
+  munmap(data, size);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void SortedSMSStore::readJournal(const char *data, size_t size,
+                                 std::string filename) throw(GsmException)
+{
+  SMSStoreMap &byIndex = _sortedSMSStore[ByIndex];
+  const char *end = data + size;
+  const char *p = data;
+  while ((size_t)(end - p) >= JOURNAL_HEADER_SIZE)
+  {
+    unsigned int dataLen = getUnsignedShort(p + 1);
+    size_t recordLen = JOURNAL_HEADER_SIZE + dataLen + JOURNAL_CHECKSUM_SIZE;
+    if ((size_t)(end - p) < recordLen)
+      break;                    // interrupted append
+
+    if (gsmlib::crc32(p, recordLen - JOURNAL_CHECKSUM_SIZE) !=
+        getUnsignedLong(p + recordLen - JOURNAL_CHECKSUM_SIZE))
+      throw GsmException(stringPrintf(_("corrupt SMS store file '%s'"),
+                                      filename.c_str()), ParameterError);
+
+    int id = getUnsignedLong(p + 3);
+    const char *recordData = p + JOURNAL_HEADER_SIZE;
+    SMSStoreMap::iterator i = byIndex.find(SMSMapKey(*this, ByIndex, id));
+    if (p[0] == JOURNAL_MESSAGE && dataLen > 0 &&
+        (unsigned char)recordData[0] <= 2 && i == byIndex.end())
+    {
+      indexEntry(new SMSStoreEntry(std::string(recordData + 1, dataLen - 1),
+                                   (SMSMessage::MessageType)recordData[0],
+                                   id));
+      if ((unsigned int)id >= _nextIndex)
+        _nextIndex = id + 1;
     }
+    else if (p[0] == JOURNAL_TOMBSTONE && i != byIndex.end())
+    {
+      delete i->second;
+      byIndex.erase(i);
+      _deadRecords += 2;
+    }
+    else
+      throw GsmException(stringPrintf(_("corrupt SMS store file '%s'"),
+                                      filename.c_str()), ParameterError);
+    p += recordLen;
+  }
+  _journalEnd = 2 + (p - data);
+}
+
+void SortedSMSStore::appendToJournal(std::string record) throw(GsmException)
+{
+#ifdef HAVE_UNISTD_H
+  // start a new file with the version number
+  if (_journalEnd == 0)
+  {
+    char version[2];
+    putUnsignedShort(version, SMS_STORE_JOURNAL_FORMAT_VERSION);
+    record = std::string(version, 2) + record;
+  }
+
+  int fd = open(_filename.c_str(), O_WRONLY | O_CREAT, 0666);
+  if (fd == -1)
+    throw GsmException(stringPrintf(_("error opening file '%s' for writing"),
+                                    _filename.c_str()), OSError);
+
+  // drop the remainder of an interrupted append (if any) and append
+  off_t fileSize = lseek(fd, 0, SEEK_END);
+  bool ok = fileSize != -1 &&
+    (fileSize == (off_t)_journalEnd || ftruncate(fd, _journalEnd) == 0) &&
+    lseek(fd, _journalEnd, SEEK_SET) != -1;
+  ok = ok && writeAll(fd, record.data(), record.length()) && fsync(fd) == 0;
+  close(fd);
+
+  if (! ok)
+    throw GsmException(stringPrintf(_("error writing to file '%s'"),
+                                    _filename.c_str()), OSError);
+  _journalEnd += record.length();
+#else
+  assert(0);
+#endif
+}
+
+void SortedSMSStore::writeFile() throw(GsmException)
+{
+  // format version number and entries in file order
+  std::string buffer;
+  char version[2];
+  putUnsignedShort(version, SMS_STORE_JOURNAL_FORMAT_VERSION);
+  buffer.append(version, 2);
+  for (SMSStoreMap::iterator i = _sortedSMSStore[ByIndex].begin();
+       i != _sortedSMSStore[ByIndex].end(); ++i)
+    buffer += journalRecord(i->second);
+
+  if (_filename == "")
+  {
+    writenbytes(_filename, std::cout, buffer.length(), buffer.data());
+    std::cout.flush();
+    return;
+  }
+
+  // create backup file - but only once
+  if (! _madeBackupFile)
+  {
+    makeBackupFile(_filename);
+    _madeBackupFile = true;
+  }
+
+  // the entries are written to a new file that replaces the old one
+  // when it is complete and on disk
+  replaceFile(_filename, _filename + ".new", buffer);
+  _journalEnd = buffer.length();
 }
 
 void SortedSMSStore::sync(bool fromDestructor) throw(GsmException)
 {
+  // compact the journal if it consists mostly of dead records
+  if (_fromFile && _journal && _deadRecords >= JOURNAL_MIN_DEAD_RECORDS &&
+      _deadRecords > _sortedSMSStore[ByIndex].size())
+    _changed = true;
+
   if (_fromFile && _changed)
   {
     checkReadonly();
@@ -143,63 +459,12 @@ void SortedSMSStore::sync(bool fromDestructor) throw(GsmException)
     // (avoids writing to stdout multiple times)
     if (_filename == "" && ! fromDestructor) return;
 
-    // create backup file - but only once
-    if (! _madeBackupFile && _filename != "") // don't make backup of stdout
-    {
-      renameToBackupFile(_filename);
-      _madeBackupFile = true;
-    }
-
-    // open stream
-    std::ostream *pbs = NULL;
-    try
-    {
-      if (_filename == "")
-        pbs = &std::cout;
-      else
-	pbs = new std::ofstream(_filename.c_str(), std::ios::out | std::ios::binary);
-      
-      if (pbs->bad())
-        throw GsmException(
-          stringPrintf(_("error opening file '%s' for writing"),
-                       (_filename == "" ? _("<STDOUT>") :
-                        _filename.c_str())),
-          OSError);
-
-      // write version number
-      unsigned_int_2 version = htons(SMS_STORE_FILE_FORMAT_VERSION);
-      writenbytes(_filename, *pbs, 2, (char*)&version);
-
-      // and write the entries
-      for (SMSStoreMap::iterator i = _sortedSMSStore.begin();
-           i != _sortedSMSStore.end(); ++i)
-      {
-        // create PDU and write length
-        std::string pdu = i->second->message()->encode();
-        unsigned_int_2 pduLen = htons(pdu.length());
-        writenbytes(_filename, *pbs, 2, (char*)&pduLen);
-
-        // write reserved field (was formerly index)
-        unsigned_int_4 reserved = htonl(0);
-        writenbytes(_filename, *pbs, 4, (char*)&reserved);
-        
-        // write message type
-        char messageType = i->second->message()->messageType();
-        writenbytes(_filename, *pbs, 1, (char*)&messageType);
-
-        // write PDU
-        writenbytes(_filename, *pbs, pdu.length(), pdu.data());
-      }
-    }
-    catch(GsmException &e)
-    {
-      if (pbs != &std::cout) delete pbs;
-      throw;
-    }
-    // close file
-    if (pbs != &std::cout) delete pbs;
+    writeFile();
 
+    // further changes are appended to the file
     _changed = false;
+    _journal = _filename != "";
+    _deadRecords = 0;
   }
 }
 
@@ -212,8 +477,21 @@ void SortedSMSStore::checkReadonly() throw(GsmException)
 
 SortedSMSStore::SortedSMSStore(std::string filename) throw(GsmException) :
   _changed(false), _fromFile(true), _madeBackupFile(false),
-  _sortOrder(ByDate), _readonly(false), _filename(filename), _nextIndex(0)
+  _sortOrder(ByDate), _readonly(false), _filename(filename), _nextIndex(0),
+#ifdef HAVE_UNISTD_H
+  _journal(true),
+#else
+  _journal(false),
+#endif
+  _journalEnd(0), _deadRecords(0)
 {
+  for (int i = 0; i < SORT_ORDER_COUNT; ++i)
+    _indexBuilt[i] = (i == ByIndex);
+
+  // map the file into memory if possible
+  if (readMappedSMSFile(filename))
+    return;
+
   // open the file
   std::ifstream pbs(filename.c_str(), std::ios::in | std::ios::binary);
   if (pbs.bad())
@@ -225,9 +503,13 @@ SortedSMSStore::SortedSMSStore(std::string filename) throw(GsmException) :
 
 SortedSMSStore::SortedSMSStore(bool fromStdin) throw(GsmException) :
   _changed(false), _fromFile(true), _madeBackupFile(false),
-  _sortOrder(ByDate), _readonly(fromStdin), _nextIndex(0)
+  _sortOrder(ByDate), _readonly(fromStdin), _nextIndex(0), _journal(false),
+  _journalEnd(0), _deadRecords(0)
   // _filename is "" - this means stdout
 {
+  for (int i = 0; i < SORT_ORDER_COUNT; ++i)
+    _indexBuilt[i] = (i == ByIndex);
+
   // read from stdin
   if (fromStdin)
     readSMSFile(std::cin, (std::string)_("<STDIN>"));
@@ -236,8 +518,12 @@ SortedSMSStore::SortedSMSStore(bool fromStdin) throw(GsmException) :
 SortedSMSStore::SortedSMSStore(SMSStoreRef meSMSStore)
   throw(GsmException) :
   _changed(false), _fromFile(false), _madeBackupFile(false),
-  _sortOrder(ByDate), _readonly(false), _meSMSStore(meSMSStore)
+  _sortOrder(ByDate), _readonly(false), _meSMSStore(meSMSStore),
+  _nextIndex(0), _journal(false), _journalEnd(0), _deadRecords(0)
 {
+  for (int i = 0; i < SORT_ORDER_COUNT; ++i)
+    _indexBuilt[i] = (i == ByIndex);
+
   // It is necessary to count the entries read because
   // the maximum index into the SMS store may be larger than smsStore.size()
   int entriesRead = 0;
@@ -249,77 +535,121 @@ SortedSMSStore::SortedSMSStore(SMSStoreRef meSMSStore)
       break;                 // ready
     if (! _meSMSStore()[i].empty())
     {
-      _sortedSMSStore.insert(
-        SMSStoreMap::value_type(
-          SMSMapKey(*this,
-                    _meSMSStore()[i].message()->serviceCentreTimestamp()),
-          &_meSMSStore()[i])
-        );
+      indexEntry(&_meSMSStore()[i]);
       ++entriesRead;
       reportProgress(entriesRead);
     }
   }
 }
 
-void SortedSMSStore::setSortOrder(SortOrder newOrder)
+SMSMapKey SortedSMSStore::entryKey(SortOrder sortOrder, SMSStoreEntry *entry)
 {
-  if (_sortOrder == newOrder) return; // nothing to be done
-
-  SMSStoreMap savedSMSStore = _sortedSMSStore;
-  _sortedSMSStore = SMSStoreMap();
-  _sortOrder = newOrder;
-
-  switch (newOrder)
+  switch (sortOrder)
   {
   case ByIndex:
-  {
-    for (SMSStoreMap::iterator i = savedSMSStore.begin();
-         i != savedSMSStore.end(); ++i)
-      _sortedSMSStore.insert(
-        SMSStoreMap::value_type(SMSMapKey(*this, (i->second->index())),
-                                i->second));
-    break;
-  }
+    return SMSMapKey(*this, sortOrder, entry->index());
   case ByDate:
-  {
-    for (SMSStoreMap::iterator i = savedSMSStore.begin();
-         i != savedSMSStore.end(); ++i)
-      _sortedSMSStore.insert(
-        SMSStoreMap::value_type(
-          SMSMapKey(*this, (i->second->message()->serviceCentreTimestamp())),
-          i->second));
-    break;
-  }
+    return SMSMapKey(*this, sortOrder,
+                     entry->message()->serviceCentreTimestamp());
   case ByAddress:
-  {
-    for (SMSStoreMap::iterator i = savedSMSStore.begin();
-         i != savedSMSStore.end(); ++i)
-      _sortedSMSStore.insert(
-        SMSStoreMap::value_type(
-          SMSMapKey(*this, (i->second->message()->address())),
-          i->second));
-    break;
-  }
+    return SMSMapKey(*this, sortOrder, entry->message()->address());
   case ByType:
-  {
-    for (SMSStoreMap::iterator i = savedSMSStore.begin();
-         i != savedSMSStore.end(); ++i)
-      _sortedSMSStore.insert(
-        SMSStoreMap::value_type(
-          SMSMapKey(*this, (i->second->message()->messageType())),
-          i->second));
-    break;
-  }
+    return SMSMapKey(*this, sortOrder, entry->messageType());
   default:
     assert(0);
-    break;
+    return SMSMapKey(*this, sortOrder, 0);
+  }
+}
+
+SMSStoreMap &SortedSMSStore::index(SortOrder sortOrder)
+{
+  if (! _indexBuilt[sortOrder])
+  {
+    // build the new index from the ByIndex index
+    SMSStoreMap &newIndex = _sortedSMSStore[sortOrder];
+    SMSStoreMap &byIndex = _sortedSMSStore[ByIndex];
+    newIndex.clear();
+    for (SMSStoreMap::iterator i = byIndex.begin(); i != byIndex.end(); ++i)
+      newIndex.insert(SMSStoreMap::value_type(entryKey(sortOrder, i->second),
+                                              i->second));
+    _indexBuilt[sortOrder] = true;
+  }
+  return _sortedSMSStore[sortOrder];
+}
+
+SortedSMSStore::iterator SortedSMSStore::indexEntry(SMSStoreEntry *entry)
+{
+  iterator result;
+  for (int o = 0; o < SORT_ORDER_COUNT; ++o)
+    if (_indexBuilt[o])
+    {
+      SMSStoreMap::iterator i =
+        _sortedSMSStore[o].insert(
+          SMSStoreMap::value_type(entryKey((SortOrder)o, entry), entry));
+      if (o == _sortOrder)
+        result = i;
+    }
+  return result;
+}
+
+void SortedSMSStore::eraseEntry(SMSStoreEntry *entry) throw(GsmException)
+{
+  checkReadonly();
+  if (_fromFile && _journal)
+  {
+    appendToJournal(journalRecord(JOURNAL_TOMBSTONE, entry->index(), ""));
+    _deadRecords += 2;
   }
+  else
+    _changed = true;
+
+  for (int o = 0; o < SORT_ORDER_COUNT; ++o)
+    if (_indexBuilt[o])
+    {
+      SMSStoreMap &sortedIndex = _sortedSMSStore[o];
+      std::pair<SMSStoreMap::iterator, SMSStoreMap::iterator> range =
+        sortedIndex.equal_range(entryKey((SortOrder)o, entry));
+      SMSStoreMap::iterator i;
+      for (i = range.first; i != range.second; ++i)
+        if (i->second == entry)
+          break;
+      // the key may have changed after insertion, search all entries then
+      if (i == range.second)
+        for (i = sortedIndex.begin(); i != sortedIndex.end(); ++i)
+          if (i->second == entry)
+            break;
+      assert(i != sortedIndex.end());
+      sortedIndex.erase(i);
+    }
+
+  // deallocate memory or remove from underlying ME SMS store
+  if (_fromFile)
+    delete entry;
+  else
+    _meSMSStore->erase((SMSStore::iterator)entry);
+}
+
+void SortedSMSStore::setSearchIndex(Ref<SMSSearchIndex> searchIndex)
+  throw(GsmException)
+{
+  assert(_fromFile);
+  searchIndex->update(*this);
+  // do not reuse identifiers of erased messages that are still in the index
+  if (searchIndex->nextId() > _nextIndex)
+    _nextIndex = searchIndex->nextId();
+  _searchIndex = searchIndex;
+}
+
+void SortedSMSStore::setSortOrder(SortOrder newOrder)
+{
+  // the index for the new sort order is built when it is first used
+  _sortOrder = newOrder;
 }
 
 int SortedSMSStore::max_size() const
 {
   if (_fromFile)
-    return _sortedSMSStore.max_size();
+    return _sortedSMSStore[ByIndex].max_size();
   else
     return _meSMSStore->max_size();
 }
@@ -327,7 +657,7 @@ int SortedSMSStore::max_size() const
 int SortedSMSStore::capacity() const
 {
   if (_fromFile)
-    return _sortedSMSStore.max_size();
+    return _sortedSMSStore[ByIndex].max_size();
   else
     return _meSMSStore->capacity();
 }
@@ -336,51 +666,38 @@ SortedSMSStore::iterator
 SortedSMSStore::insert(const SMSStoreEntry& x) throw(GsmException)
 {
   checkReadonly();
-  _changed = true;
   SMSStoreEntry *newEntry;
 
+  // the position in the current index is returned, so it must exist
+  currentIndex();
+
   if (_fromFile)
+  {
     newEntry = new SMSStoreEntry(x.message(), _nextIndex++);
+    if (_journal)
+      try
+      {
+        appendToJournal(journalRecord(newEntry));
+      }
+      catch (GsmException &e)
+      {
+        delete newEntry;
+        throw;
+      }
+    else
+      _changed = true;
+  }
   else
   {
+    _changed = true;
     SMSStoreEntry newMEEntry(x.message());
     newEntry = _meSMSStore->insert(newMEEntry);
   }
   
-  switch (_sortOrder)
-  {
-  case ByIndex:
-    return
-      _sortedSMSStore.
-      insert(SMSStoreMap::value_type(SMSMapKey(*this, newEntry->index()),
-                                     newEntry));
-    break;
-  case ByDate:
-    return
-      _sortedSMSStore.
-      insert(SMSStoreMap::value_type(
-        SMSMapKey(*this, newEntry->message()->serviceCentreTimestamp()),
-        newEntry));
-    break;
-  case ByAddress:
-    return
-      _sortedSMSStore.
-      insert(SMSStoreMap::value_type(
-        SMSMapKey(*this, newEntry->message()->address()),
-        newEntry));
-    break;
-  case ByType:
-    return
-      _sortedSMSStore.
-      insert(SMSStoreMap::value_type(
-        SMSMapKey(*this, newEntry->message()->messageType()),
-        newEntry));
-    break;
-  default:
-    assert(0);
-    break;
-  }
-  return SortedSMSStore::iterator();
+  iterator result = indexEntry(newEntry);
+  if (_fromFile && ! _searchIndex.isnull())
+    _searchIndex->add(*newEntry);
+  return result;
 }
 
 SortedSMSStore::iterator
@@ -393,102 +710,75 @@ SortedSMSStore::insert(iterator position, const SMSStoreEntry& x)
 SortedSMSStore::size_type SortedSMSStore::erase(Address &key)
   throw(GsmException)
 {
-  assert(_sortOrder == ByAddress);
-
-  SMSMapKey mapKey(*this, key);
-
-  // deallocate memory or remove from underlying ME SMS store
-  for (SMSStoreMap::iterator i = _sortedSMSStore.find(mapKey);
-       i != _sortedSMSStore.end() && i->first == mapKey; ++i)
-  {
-    checkReadonly();
-    _changed = true;
-    if (_fromFile)
-      delete i->second;
-    else
-      _meSMSStore->erase((SMSStore::iterator)i->second);
-  }
-
-  return _sortedSMSStore.erase(mapKey);
+  std::pair<iterator, iterator> range = equal_range(key);
+  size_type result = std::distance(range.first, range.second);
+  erase(range.first, range.second);
+  return result;
 }
 
 SortedSMSStore::size_type SortedSMSStore::erase(int key)
   throw(GsmException)
 {
-  assert(_sortOrder == ByIndex || _sortOrder == ByType);
-
-  SMSMapKey mapKey(*this, key);
-
-  // deallocate memory or remove from underlying ME SMS store
-  for (SMSStoreMap::iterator i = _sortedSMSStore.find(mapKey);
-       i != _sortedSMSStore.end() && i->first == mapKey; ++i)
-  {
-    checkReadonly();
-    _changed = true;
-    if (_fromFile)
-      delete i->second;
-    else
-      _meSMSStore->erase((SMSStore::iterator)i->second);
-  }
-
-  return _sortedSMSStore.erase(mapKey);
+  std::pair<iterator, iterator> range = equal_range(key);
+  size_type result = std::distance(range.first, range.second);
+  erase(range.first, range.second);
+  return result;
 }
 
 SortedSMSStore::size_type SortedSMSStore::erase(Timestamp &key)
   throw(GsmException)
 {
-  assert(_sortOrder == ByDate);
-
-  SMSMapKey mapKey(*this, key);
-
-  // deallocate memory or remove from underlying ME SMS store
-  for (SMSStoreMap::iterator i = _sortedSMSStore.find(mapKey);
-       i != _sortedSMSStore.end() && i->first == mapKey; ++i)
-  {
-    checkReadonly();
-    _changed = true;
-    if (_fromFile)
-      delete i->second;
-    else
-      _meSMSStore->erase((SMSStore::iterator)i->second);
-  }
-
-  return _sortedSMSStore.erase(mapKey);
+  std::pair<iterator, iterator> range = equal_range(key);
+  size_type result = std::distance(range.first, range.second);
+  erase(range.first, range.second);
+  return result;
 }
 
 void SortedSMSStore::erase(iterator position)
   throw(GsmException)
 {
-  checkReadonly();
-  _changed = true;
-  // deallocate memory or remove from underlying ME SMS store
-  if (_fromFile)
-    delete ((SMSStoreMap::iterator)position)->second;
-  else
-    _meSMSStore->erase((SMSStore::iterator)
-                       ((SMSStoreMap::iterator)position)->second);
-  _sortedSMSStore.erase(position);
+  eraseEntry(((SMSStoreMap::iterator)position)->second);
 }
 
 void SortedSMSStore::erase(iterator first, iterator last)
   throw(GsmException)
 {
-  checkReadonly();
-  _changed = true;
+  // collect entries first, erasing invalidates the iterators
+  std::vector<SMSStoreEntry*> entries;
   for (SMSStoreMap::iterator i = first; i != last; ++i)
-    if (_fromFile)
-      delete i->second;
-    else
-      _meSMSStore->erase((SMSStore::iterator)i->second);
-  _sortedSMSStore.erase(first, last);
+    entries.push_back(i->second);
+  for (std::vector<SMSStoreEntry*>::iterator j = entries.begin();
+       j != entries.end(); ++j)
+    eraseEntry(*j);
 }
 
 void SortedSMSStore::clear() throw(GsmException)
 {
   checkReadonly();
   _changed = true;
-  for (iterator i = begin(); i != end(); i++)
-    erase(i);
+  if (! _fromFile)
+  {
+    // let the ME erase all messages at once if possible
+    _meSMSStore->clear();
+    for (int o = 0; o < SORT_ORDER_COUNT; ++o)
+      _sortedSMSStore[o].clear();
+    return;
+  }
+
+  for (SMSStoreMap::iterator i = _sortedSMSStore[ByIndex].begin();
+       i != _sortedSMSStore[ByIndex].end(); ++i)
+    delete i->second;
+  for (int o = 0; o < SORT_ORDER_COUNT; ++o)
+    _sortedSMSStore[o].clear();
+
+  // a journal is replaced by an empty one at once instead of appending
+  // one tombstone per message
+  if (_journal)
+  {
+    writeFile();
+    _changed = false;
+    _deadRecords = 0;
+  }
 }
 
 SortedSMSStore::~SortedSMSStore()
@@ -496,9 +786,110 @@ SortedSMSStore::~SortedSMSStore()
   if (_fromFile)
   {
     sync(true);
-    for (SMSStoreMap::iterator i = _sortedSMSStore.begin();
-         i != _sortedSMSStore.end(); ++i)
+    for (SMSStoreMap::iterator i = _sortedSMSStore[ByIndex].begin();
+         i != _sortedSMSStore[ByIndex].end(); ++i)
       delete i->second;
   }
 }
 
+// SMSStoreReader members
+
+SMSStoreReader::SMSStoreReader(std::string filename) throw(GsmException) :
+  _filename(filename),
+  _file(filename.c_str(), std::ios::in | std::ios::binary), _is(_file),
+  _version(0), _nextIndex(0)
+{
+  if (! _file)
+    throw GsmException(stringPrintf(_("cannot open file '%s'"),
+                                    filename.c_str()), OSError);
+  readVersion();
+
+  // find the erased messages first, so that they can be skipped
+  if (_version == SMS_STORE_JOURNAL_FORMAT_VERSION)
+  {
+    std::streampos start = _is.tellg();
+    char header[JOURNAL_HEADER_SIZE];
+    while (readnbytes(_filename, _is, JOURNAL_HEADER_SIZE, header, false))
+    {
+      if (header[0] == JOURNAL_TOMBSTONE)
+        _erased.insert(getUnsignedLong(header + 3));
+      _is.seekg(getUnsignedShort(header + 1) + JOURNAL_CHECKSUM_SIZE,
+                std::ios::cur);
+    }
+    _is.clear();
+    _is.seekg(start);
+  }
+}
+
+SMSStoreReader::SMSStoreReader() throw(GsmException) :
+  _filename(_("<STDIN>")), _is(std::cin), _version(0), _nextIndex(0)
+{
+  readVersion();
+
+  // erased messages can only be found in a first pass over the file
+  if (_version == SMS_STORE_JOURNAL_FORMAT_VERSION)
+    throw GsmException(_("SMS store files in journal format cannot be "
+                         "read from <STDIN> message by message"),
+                       ParameterError);
+}
+
+void SMSStoreReader::readVersion() throw(GsmException)
+{
+  char buf[2];
+  if (! readnbytes(_filename, _is, 2, buf, false))
+    return;                     // file is empty
+  _version = getUnsignedShort(buf);
+  if (_version != SMS_STORE_JOURNAL_FORMAT_VERSION)
+    checkVersion(_filename, buf);
+}
+
+bool SMSStoreReader::next(SMSStoreEntryRef &entry) throw(GsmException)
+{
+  if (_version == SMS_STORE_FILE_FORMAT_VERSION)
+  {
+    char header[SMS_STORE_RECORD_HEADER_SIZE];
+    char pdu[SMS_STORE_MAX_PDU_LENGTH];
+    if (! readnbytes(_filename, _is, 2, header, false))
+      return false;
+    readnbytes(_filename, _is, SMS_STORE_RECORD_HEADER_SIZE - 2, header + 2);
+    unsigned int pduLen = checkRecordHeader(_filename, header);
+    readnbytes(_filename, _is, pduLen, pdu);
+    entry = new SMSStoreEntry(std::string(pdu, pduLen),
+                              (SMSMessage::MessageType)header[6],
+                              _nextIndex++);
+    return true;
+  }
+
+  if (_version == SMS_STORE_JOURNAL_FORMAT_VERSION)
+  {
+    std::string record(JOURNAL_HEADER_SIZE, '\0');
+    while (readnbytes(_filename, _is, JOURNAL_HEADER_SIZE, &record[0], false))
+    {
+      // a truncated record is the remainder of an interrupted append
+      unsigned int dataLen = getUnsignedShort(record.data() + 1);
+      record.resize(JOURNAL_HEADER_SIZE + dataLen + JOURNAL_CHECKSUM_SIZE);
+      if (! readnbytes(_filename, _is, dataLen + JOURNAL_CHECKSUM_SIZE,
+                       &record[JOURNAL_HEADER_SIZE], false))
+        break;
+
+      const char *p = record.data();
+      if (gsmlib::crc32(p, JOURNAL_HEADER_SIZE + dataLen) !=
+          getUnsignedLong(p + JOURNAL_HEADER_SIZE + dataLen) ||
+          (p[0] == JOURNAL_MESSAGE &&
+           (dataLen == 0 || (unsigned char)p[JOURNAL_HEADER_SIZE] > 2)))
+        throw GsmException(stringPrintf(_("corrupt SMS store file '%s'"),
+                                        _filename.c_str()), ParameterError);
+
+      int id = getUnsignedLong(p + 3);
+      if (p[0] == JOURNAL_MESSAGE && _erased.find(id) == _erased.end())
+      {
+        entry = new SMSStoreEntry(
+          std::string(p + JOURNAL_HEADER_SIZE + 1, dataLen - 1),
+          (SMSMessage::MessageType)p[JOURNAL_HEADER_SIZE], id);
+        return true;
+      }
+      record.resize(JOURNAL_HEADER_SIZE);
+    }
+  }
+  return false;
+}
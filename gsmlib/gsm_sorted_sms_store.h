@@ -18,6 +18,8 @@
 #include <gsmlib/gsm_map_key.h>
 #include <string>
 #include <map>
+#include <set>
+#include <fstream>
 #include <assert.h>
 
 namespace gsmlib
@@ -25,6 +27,7 @@ namespace gsmlib
   // MapKey for SortedSMSStore
   
   class SortedSMSStore;
+  class SMSSearchIndex;
   typedef MapKey<SortedSMSStore> SMSMapKey;
 
   // maps key (see SortedSMSStore::SortOrder) to entry
@@ -51,6 +54,17 @@ namespace gsmlib
   // The class SortedSMSStore makes the SMS store more manageable:
   // - empty slots in the ME phonebook are hidden by the API
   // - the class transparently handles stores that reside in files
+  // - one index (multimap) is kept per sort order; an index is built
+  //   the first time its sort order is used and is updated incrementally
+  //   by insert() and erase() afterwards, so switching between sort orders
+  //   is cheap
+  // - the ByIndex index always exists, it holds the entries in file order;
+  //   messages read from file are only decoded when they are accessed
+  //   or needed for building one of the other indices
+  // - files are written in the journal format: a change to a store read
+  //   from such a file is appended to it immediately (tombstones mark
+  //   erased messages), the file is only rewritten by sync() if it was
+  //   read in the old format or if it contains too many erased messages
 
   class SortedSMSStore : public RefBase, public NoCopy
   {
@@ -63,20 +77,66 @@ namespace gsmlib
                                 // (default is ByDate)
     bool _readonly;             // =true if read from stdin
     std::string _filename;           // name of the file if store from file
-    SMSStoreMap _sortedSMSStore; // store from file
+    SMSStoreMap _sortedSMSStore[SORT_ORDER_COUNT]; // one index per sort order
+    bool _indexBuilt[SORT_ORDER_COUNT]; // true if index is up to date
     SMSStoreRef _meSMSStore;    // store if from ME
 
     unsigned int _nextIndex;    // next index to use for file-based store
+    bool _journal;              // true if changes are appended to the file
+    unsigned long _journalEnd;  // size of the valid part of the file
+    unsigned int _deadRecords;  // number of erased messages and tombstones
+    Ref<SMSSearchIndex> _searchIndex; // updated by insert() if set
 
     // initial read of SMS file
     void readSMSFile(std::istream &pbs, std::string filename) throw(GsmException);
+    void readSMSFile(const char *data, size_t size, std::string filename)
+      throw(GsmException);
+
+    // read SMS file by mapping it into memory
+    // return false if the file cannot be mapped
+    bool readMappedSMSFile(std::string filename) throw(GsmException);
+
+    // add entry given the message header and PDU read from file
+    void addFileEntry(const char *header, const char *pdu);
+
+    // read the records of a journal (without version number)
+    void readJournal(const char *data, size_t size, std::string filename)
+      throw(GsmException);
+
+    // append a record to the journal file and flush it to disk
+    void appendToJournal(std::string record) throw(GsmException);
     
+    // write all entries to the file (or stdout) as a new journal
+    // the file is replaced only after the new one is complete and on disk
+    void writeFile() throw(GsmException);
+
     // synchronize SortedSMSStore with file (no action if in ME)
     void sync(bool fromDestructor) throw(GsmException);
     
     // throw an exception if _readonly is set
     void checkReadonly() throw(GsmException);
 
+    // return index for the current sort order
+    SMSStoreMap &currentIndex() {return index(_sortOrder);}
+
+    // return index for sortOrder, build it first if necessary
+    SMSStoreMap &index(SortOrder sortOrder);
+
+    // return key of entry for given sort order
+    SMSMapKey entryKey(SortOrder sortOrder, SMSStoreEntry *entry);
+
+    // add entry to all built indices, return position in current index
+    // (if it is built)
+    SortedSMSStoreIterator indexEntry(SMSStoreEntry *entry);
+
+    // remove entry from all built indices, then deallocate it or remove it
+    // from the underlying ME SMS store
+    void eraseEntry(SMSStoreEntry *entry) throw(GsmException);
+
+    // return the index used for int keys (ByIndex or ByType)
+    SortOrder intKeyOrder() const
+      {return _sortOrder == ByType ? ByType : ByIndex;}
+
   public:
     // iterator defs
     typedef SortedSMSStoreIterator iterator;
@@ -91,6 +151,10 @@ namespace gsmlib
     // constructor for ME-based store
     SortedSMSStore(SMSStoreRef meSMSStore) throw(GsmException);
 
+    // attach search index (file-based stores only), messages not yet in
+    // the index are added to it, inserted messages are added as well
+    void setSearchIndex(Ref<SMSSearchIndex> searchIndex) throw(GsmException);
+
     // handle sorting
     void setSortOrder(SortOrder newOrder);
     SortOrder sortOrder() const {return _sortOrder;}
@@ -99,11 +163,11 @@ namespace gsmlib
     // these are suitable to use stdc++ lib algorithms and iterators
     
     // traversal commands
-    iterator begin() {return _sortedSMSStore.begin();}
-    iterator end() {return _sortedSMSStore.end();}
+    iterator begin() {return currentIndex().begin();}
+    iterator end() {return currentIndex().end();}
 
     // the size macros return the number of used entries
-    int size() const {return _sortedSMSStore.size();}
+    int size() const {return _sortedSMSStore[ByIndex].size();}
     int max_size() const;
     int capacity() const;
     bool empty() const throw(GsmException) {return size() == 0;}
@@ -116,84 +180,88 @@ namespace gsmlib
     iterator insert(iterator position, const SMSStoreEntry& x)
       throw(GsmException);
 
+    // count() and equal_range() may be used with any sort order, they
+    // look up the index matching the key type (int keys: ByIndex, or
+    // ByType if that is the current sort order)
+    // the other lookup functions require the matching sort order because
+    // their result is compared against end()
     SMSStoreMap::size_type count(Address &key)
       {
-        assert(_sortOrder == ByAddress);
-        return _sortedSMSStore.count(SMSMapKey(*this, key));
+        return index(ByAddress).count(SMSMapKey(*this, ByAddress, key));
       }
     iterator find(Address &key)
       {
         assert(_sortOrder == ByAddress);
-        return _sortedSMSStore.find(SMSMapKey(*this, key));
+        return currentIndex().find(SMSMapKey(*this, key));
       }
     iterator lower_bound(Address &key)
       {
         assert(_sortOrder == ByAddress);
-        return _sortedSMSStore.lower_bound(SMSMapKey(*this, key));
+        return currentIndex().lower_bound(SMSMapKey(*this, key));
       }
     iterator upper_bound(Address &key)
       {
         assert(_sortOrder == ByAddress);
-        return _sortedSMSStore.upper_bound(SMSMapKey(*this, key));
+        return currentIndex().upper_bound(SMSMapKey(*this, key));
       }
     std::pair<iterator, iterator> equal_range(Address &key)
       {
-        assert(_sortOrder == ByAddress);
-        return _sortedSMSStore.equal_range(SMSMapKey(*this, key));
+        return index(ByAddress).equal_range(SMSMapKey(*this, ByAddress, key));
       }
 
     SMSStoreMap::size_type count(Timestamp &key)
       {
-        assert(_sortOrder == ByDate);
-        return _sortedSMSStore.count(SMSMapKey(*this, key));
+        return index(ByDate).count(SMSMapKey(*this, ByDate, key));
       }
     iterator find(Timestamp &key)
       {
         assert(_sortOrder == ByDate);
-        return _sortedSMSStore.find(SMSMapKey(*this, key));
+        return currentIndex().find(SMSMapKey(*this, key));
       }
     iterator lower_bound(Timestamp &key)
       {
         assert(_sortOrder == ByDate);
-        return _sortedSMSStore.lower_bound(SMSMapKey(*this, key));
+        return currentIndex().lower_bound(SMSMapKey(*this, key));
       }
     iterator upper_bound(Timestamp &key)
       {
         assert(_sortOrder == ByDate);
-        return _sortedSMSStore.upper_bound(SMSMapKey(*this, key));
+        return currentIndex().upper_bound(SMSMapKey(*this, key));
       }
     std::pair<iterator, iterator> equal_range(Timestamp &key)
       {
-        assert(_sortOrder == ByDate);
-        return _sortedSMSStore.equal_range(SMSMapKey(*this, key));
+        return index(ByDate).equal_range(SMSMapKey(*this, ByDate, key));
       }
 
     SMSStoreMap::size_type count(int key)
       {
-        assert(_sortOrder == ByIndex || _sortOrder == ByType);
-        return _sortedSMSStore.count(SMSMapKey(*this, key));
+        return index(intKeyOrder()).count(SMSMapKey(*this, intKeyOrder(),
+                                                    key));
       }
     iterator find(int key)
       {
         assert(_sortOrder == ByIndex || _sortOrder == ByType);
-        return _sortedSMSStore.find(SMSMapKey(*this, key));
+        return currentIndex().find(SMSMapKey(*this, key));
       }
     iterator lower_bound(int key)
       {
         assert(_sortOrder == ByIndex || _sortOrder == ByType);
-        return _sortedSMSStore.lower_bound(SMSMapKey(*this, key));
+        return currentIndex().lower_bound(SMSMapKey(*this, key));
       }
     iterator upper_bound(int key)
       {
         assert(_sortOrder == ByIndex || _sortOrder == ByType);
-        return _sortedSMSStore.upper_bound(SMSMapKey(*this, key));
+        return currentIndex().upper_bound(SMSMapKey(*this, key));
       }
     std::pair<iterator, iterator> equal_range(int key)
       {
-        assert(_sortOrder == ByIndex || _sortOrder == ByType);
-        return _sortedSMSStore.equal_range(SMSMapKey(*this, key));
+        return index(intKeyOrder()).equal_range(SMSMapKey(*this,
+                                                          intKeyOrder(),
+                                                          key));
       }
 
+    // erase functions accept keys of any type and iterators into any
+    // of the indices
     size_type erase(Address &key) throw(GsmException);
     size_type erase(int key) throw(GsmException);
     size_type erase(Timestamp &key) throw(GsmException);
@@ -207,9 +275,45 @@ namespace gsmlib
     // destructor
     // writes back change to file if store is in file
     ~SortedSMSStore();
+
+    friend class SMSSearchIndex;
   };
 
   typedef Ref<SortedSMSStore> SortedSMSStoreRef;
+
+  // The class SMSStoreReader reads the messages of an SMS store file
+  // (see SortedSMSStore) one by one in file order, without keeping them
+  // in memory
+  // messages are decoded when they are accessed for the first time
+  // erased messages are skipped; this requires a first pass over the
+  // file, so files in journal format cannot be read from stdin
+
+  class SMSStoreReader : public RefBase, public NoCopy
+  {
+  private:
+    std::string _filename;      // name of the file
+    std::ifstream _file;        // the file if not reading from stdin
+    std::istream &_is;          // stream to read from
+    unsigned int _version;      // format version (0 if file is empty)
+    unsigned int _nextIndex;    // index of next message (version 1 files)
+    std::set<int> _erased;      // indices of erased messages
+
+    // read the version number of the file format
+    void readVersion() throw(GsmException);
+
+  public:
+    // read from file
+    SMSStoreReader(std::string filename) throw(GsmException);
+    // read from stdin
+    // throws an exception if the input is in journal format
+    SMSStoreReader() throw(GsmException);
+
+    // read the next message, return false at end of file
+    // the indices of the entries are the same as for SortedSMSStore
+    bool next(SMSStoreEntryRef &entry) throw(GsmException);
+  };
+
+  typedef Ref<SMSStoreReader> SMSStoreReaderRef;
 };
 
 #endif // GSM_SORTED_SMS_STORE_H
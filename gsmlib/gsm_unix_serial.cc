@@ -16,6 +16,7 @@
 #include <gsmlib/gsm_nls.h>
 #include <gsmlib/gsm_unix_serial.h>
 #include <gsmlib/gsm_util.h>
+#include <gsmlib/gsm_parser.h>
 #include <termios.h>
 #include <fcntl.h>
 #include <iostream>
@@ -28,11 +29,61 @@
 #include <signal.h>
 #include <pthread.h>
 #include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/time.h>
 
 using namespace gsmlib;
 
-static const int holdoff[] = {2000000, 1000000, 400000};
+// waiting times for the DTR reset, increased with each try
+static const int holdoff[] = {400000, 1000000, 2000000}; // usecs
 static const int holdoffArraySize = sizeof(holdoff) / sizeof(int);
+
+// the modem is first probed with a plain AT using short timeouts
+static const long probeTimeout = 500; // msecs
+static const int probeTries = 2;
+
+// time the ME/TA needs to switch to a new baud rate after its OK
+static const int baudRateSwitchDelay = 100000; // usecs
+
+// line speeds supported by termios, in increasing order
+static const struct LineSpeed
+{
+  speed_t _speed;
+  int _baudRate;
+} lineSpeeds[] =
+{
+  {B300, 300}, {B600, 600}, {B1200, 1200}, {B2400, 2400}, {B4800, 4800},
+  {B9600, 9600}, {B19200, 19200}, {B38400, 38400},
+#ifdef B57600
+  {B57600, 57600},
+#endif
+#ifdef B115200
+  {B115200, 115200},
+#endif
+#ifdef B230400
+  {B230400, 230400},
+#endif
+#ifdef B460800
+  {B460800, 460800},
+#endif
+#ifdef B921600
+  {B921600, 921600},
+#endif
+};
+static const int lineSpeedsSize = sizeof(lineSpeeds) / sizeof(LineSpeed);
+
+// return index of speed in lineSpeeds or -1
+static int lineSpeedIndex(speed_t speed)
+{
+  for (int i = 0; i < lineSpeedsSize; ++i)
+    if (lineSpeeds[i]._speed == speed)
+      return i;
+  return -1;
+}
+
+// initial size of the receive buffer, it grows if lines are longer
+static const size_t rxBufferSize = 1024;
   
 // alarm handling for socket read/write
 // the timerMtx is necessary since several threads cannot use the
@@ -81,61 +132,84 @@ static void stopTimer()
   pthread_mutex_unlock(&timerMtx);
 }
 
+// report time spent in an initialization phase since start
+static void reportPhase(const char *phase, const struct timeval &start)
+{
+#ifndef NDEBUG
+  if (debugLevel() >= 1)
+  {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    std::cerr << "*** " << phase << ": "
+              << (now.tv_sec - start.tv_sec) * 1000 +
+                 (now.tv_usec - start.tv_usec) / 1000
+              << " ms" << std::endl;
+  }
+#endif
+}
+
 // UnixSerialPort members
 
 void UnixSerialPort::throwModemException(std::string message) throw(GsmException)
 {
   std::ostringstream os;
-  os << message << " (errno: " << errno << "/" << strerror(errno) << ")"
-     << std::ends;
+  os << message << " (errno: " << errno << "/" << strerror(errno) << ")";
   throw GsmException(os.str(), OSError, errno);
 }
 
 void UnixSerialPort::putBack(unsigned char c)
 {
-  assert(_oldChar == -1);
-  _oldChar = c;
+  // fillBuffer() leaves room for one character in front of the data
+  assert(_rxStart > 0);
+  _rxBuffer[--_rxStart] = c;
 }
 
-int UnixSerialPort::readByte() throw(GsmException)
+void UnixSerialPort::fillBuffer() throw(GsmException)
 {
-  if (_oldChar != -1)
+  if (_rxStart == _rxEnd)
+    _rxStart = _rxEnd = 1;
+  else if (_rxEnd == _rxBuffer.size())
   {
-    int result = _oldChar;
-    _oldChar = -1;
-    return result;
+    // make room by moving unread data to the front or growing the buffer
+    if (_rxStart > 1)
+    {
+      memmove(&_rxBuffer[1], &_rxBuffer[_rxStart], _rxEnd - _rxStart);
+      _rxEnd -= _rxStart - 1;
+      _rxStart = 1;
+    }
+    else
+      _rxBuffer.resize(_rxBuffer.size() * 2);
   }
 
-  unsigned char c;
-  int timeElapsed = 0;
-  struct timeval oneSecond;
-  bool readDone = false;
+  long timeElapsed = 0;
+  ssize_t res = 0;
 
-  while (!readDone && timeElapsed < _timeoutVal)
+  while (res == 0 && timeElapsed < _timeoutVal)
   {
     if (interrupted())
       throwModemException(_("interrupted when reading from TA"));
 
     // setup fd_set data structure for select()
+    // wait at most one second to check for interrupts regularly
     fd_set fdSet;
-    oneSecond.tv_sec = 1;
-    oneSecond.tv_usec = 0;
+    long slice = std::min(_timeoutVal - timeElapsed, 1000L);
+    struct timeval sliceTime;
+    sliceTime.tv_sec = slice / 1000;
+    sliceTime.tv_usec = (slice % 1000) * 1000;
     FD_ZERO(&fdSet);
     FD_SET(_fd, &fdSet);
 
-    switch (select(FD_SETSIZE, &fdSet, NULL, NULL, &oneSecond))
+    switch (select(FD_SETSIZE, &fdSet, NULL, NULL, &sliceTime))
     {
     case 1:
       {
-	int res = read(_fd, &c, 1);
-	if (res != 1)
+	res = read(_fd, &_rxBuffer[_rxEnd], _rxBuffer.size() - _rxEnd);
+	if (res <= 0)
 	  throwModemException(_("end of file when reading from TA"));
-	else
-	  readDone = true;
 	break;
       }
     case 0:
-      ++timeElapsed;
+      timeElapsed += slice;
       break;
     default:
       if (errno != EINTR)
@@ -143,183 +217,345 @@ int UnixSerialPort::readByte() throw(GsmException)
       break;
     }
   }
-  if (!readDone)
+  if (res == 0)
     throwModemException(_("timeout when reading from TA"));
 
 #ifndef NDEBUG
   if (debugLevel() >= 2)
   {
     // some useful debugging code
-    if (c == LF)
-      std::cerr << "<LF>";
-    else if (c == CR)
-      std::cerr << "<CR>";
-    else
-      std::cerr << "<'" << (char) c << "'>";
+    for (ssize_t i = 0; i < res; ++i)
+    {
+      char c = _rxBuffer[_rxEnd + i];
+      if (c == LF)
+        std::cerr << "<LF>";
+      else if (c == CR)
+        std::cerr << "<CR>";
+      else
+        std::cerr << "<'" << c << "'>";
+    }
     std::cerr.flush();
   }
 #endif
-  return c;
+  _rxEnd += res;
+}
+
+int UnixSerialPort::readByte() throw(GsmException)
+{
+  if (_rxStart == _rxEnd)
+    fillBuffer();
+  return (unsigned char)_rxBuffer[_rxStart++];
+}
+
+void UnixSerialPort::setLineModes(speed_t lineSpeed, bool swHandshake)
+  throw(GsmException)
+{
+  struct termios t;
+
+  // get line modes
+  if (tcgetattr(_fd, &t) < 0)
+    throwModemException(_("tcgetattr failed"));
+
+  // set line speed
+  cfsetispeed(&t, lineSpeed);
+  cfsetospeed(&t, lineSpeed);
+
+  // set the device to a sane state
+  t.c_iflag |= IGNPAR | (swHandshake ? IXON | IXOFF : 0);
+  t.c_iflag &= ~(INPCK | ISTRIP | IMAXBEL |
+                 (swHandshake ? 0 : IXON |  IXOFF)
+                 | IXANY | IGNCR | ICRNL | IMAXBEL | INLCR | IGNBRK);
+  t.c_oflag &= ~(OPOST);
+  // be careful, only touch "known" flags
+  t.c_cflag &= ~(CSIZE | CSTOPB | PARENB | PARODD |
+                 (swHandshake ? CRTSCTS : 0 ));
+  t.c_cflag |= CS8 | CREAD | HUPCL | (swHandshake ? 0 : CRTSCTS) | CLOCAL;
+  t.c_lflag &= ~(ECHO | ECHOE | ECHOPRT | ECHOK | ECHOKE | ECHONL |
+                 ECHOCTL | ISIG | IEXTEN | TOSTOP | FLUSHO | ICANON);
+  t.c_lflag |= NOFLSH;
+  t.c_cc[VMIN] = 1;
+  t.c_cc[VTIME] = 0;
+
+  t.c_cc[VSUSP] = 0;
+
+  // write back
+  if (tcsetattr(_fd, TCSANOW, &t) < 0)
+    throwModemException(_("tcsetattr failed"));
+  _lineSpeed = lineSpeed;
+  _swHandshake = swHandshake;
+}
+
+void UnixSerialPort::resetDTR(int holdoff) throw(GsmException)
+{
+  // flush all pending output
+  tcflush(_fd, TCOFLUSH);
+
+  // toggle DTR to reset modem
+  int mctl = TIOCM_DTR;
+  if (ioctl(_fd, TIOCMBIC, &mctl) < 0)
+    throwModemException(_("clearing DTR failed"));
+  usleep(holdoff);
+  if (ioctl(_fd, TIOCMBIS, &mctl) < 0)
+    throwModemException(_("setting DTR failed"));
+
+  // give the ME/TA time to get ready
+  usleep(holdoff);
+
+  // flush all pending input
+  tcflush(_fd, TCIFLUSH);
+  _rxStart = _rxEnd;
+}
+
+bool UnixSerialPort::initChat(std::string command, long timeout,
+                              std::string *info) throw(GsmException)
+{
+  long saveTimeoutVal = _timeoutVal;
+  _timeoutVal = timeout;
+  bool result = false;
+  try
+  {
+    putLine(command);
+    // skip echo and empty lines
+    int readTries = 5;
+    while (readTries-- > 0)
+    {
+      std::string s = getLine();
+      if (s.find("OK") != std::string::npos ||
+          s.find("CABLE: GSM") != std::string::npos)
+      {
+        result = true;
+        break;
+      }
+      else if (s.find("ERROR") != std::string::npos)
+        break;
+      else if (info != NULL && s.length() > 0 && s[0] == '+')
+      {
+        *info = s;
+        ++readTries;            // don't count information lines
+      }
+    }
+  }
+  catch (GsmException &e)
+  {
+    _timeoutVal = saveTimeoutVal;
+    throw;
+  }
+  _timeoutVal = saveTimeoutVal;
+  return result;
+}
+
+bool UnixSerialPort::probe()
+{
+  tcflush(_fd, TCIFLUSH);
+  _rxStart = _rxEnd;
+  try
+  {
+    return initChat("AT", probeTimeout);
+  }
+  catch (GsmException &e)
+  {
+    return false;               // no answer
+  }
 }
 
 UnixSerialPort::UnixSerialPort(std::string device, speed_t lineSpeed,
 				       std::string initString, bool swHandshake)
   throw(GsmException) :
-  _oldChar(-1), _timeoutVal(TIMEOUT_SECS)
+  _rxBuffer(rxBufferSize), _rxStart(1), _rxEnd(1),
+  _timeoutVal(TIMEOUT_SECS * 1000L), _lineSpeed(lineSpeed),
+  _swHandshake(swHandshake)
 {
-  struct termios t;
-
   // open device
   _fd = open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
   if (_fd == -1)
     throwModemException(stringPrintf(_("opening device '%s'"),
                                      device.c_str()));
 
-  // switch off non-blocking mode
-  int fdFlags;
-  if ((fdFlags = fcntl(_fd, F_GETFL)) == -1)
-    {
-      close(_fd);
+  try
+  {
+    // switch off non-blocking mode
+    int fdFlags;
+    if ((fdFlags = fcntl(_fd, F_GETFL)) == -1)
       throwModemException(_("getting file status flags failed"));
-    }
-  fdFlags &= ~O_NONBLOCK;
-  if (fcntl(_fd, F_SETFL, fdFlags) == -1)
-    {
-      close(_fd);
+    fdFlags &= ~O_NONBLOCK;
+    if (fcntl(_fd, F_SETFL, fdFlags) == -1)
       throwModemException(_("switching of non-blocking mode failed"));
-    }
 
-  long int saveTimeoutVal = _timeoutVal;
-  _timeoutVal = 3;
-  int initTries = holdoffArraySize;
-  while (initTries-- > 0)
+    setLineModes(lineSpeed, swHandshake);
+
+    // phase 1: most modems answer a plain AT immediately, those don't
+    // need the (slow) DTR reset
+    struct timeval start;
+    gettimeofday(&start, NULL);
+    bool ready = false;
+    for (int i = 0; i < probeTries && ! ready; ++i)
+      ready = probe();
+    reportPhase(ready ? "AT probe succeeded" : "AT probe failed", start);
+
+    int dtrTries = 0;
+    while (1)
     {
-      // flush all pending output
-      tcflush(_fd, TCOFLUSH);
-      
-      // toggle DTR to reset modem
-      int mctl = TIOCM_DTR;
-      if (ioctl(_fd, TIOCMBIC, &mctl) < 0) {
-	close(_fd);
-	throwModemException(_("clearing DTR failed"));
-      }
-      // the waiting time for DTR toggling is increased with each loop
-      usleep(holdoff[initTries]);
-      if (ioctl(_fd, TIOCMBIS, &mctl) < 0) {
-	close(_fd);
-	throwModemException(_("setting DTR failed"));
-      }
-      // get line modes
-      if (tcgetattr(_fd, &t) < 0) {
-	close(_fd);
-	throwModemException(stringPrintf(_("tcgetattr device '%s'"),
-					 device.c_str()));
+      if (! ready)
+      {
+        // phase 2: reset modem by toggling DTR
+        // the waiting time is increased with each try
+        if (dtrTries == holdoffArraySize)
+          throw GsmException(stringPrintf(_("reset modem failed '%s'"),
+                                          device.c_str()), OtherError);
+        gettimeofday(&start, NULL);
+        resetDTR(holdoff[dtrTries++]);
+        reportPhase("DTR reset", start);
       }
-      
-      // set line speed
-      cfsetispeed(&t, lineSpeed);
-      cfsetospeed(&t, lineSpeed);
-      
-      // set the device to a sane state
-      t.c_iflag |= IGNPAR | (swHandshake ? IXON | IXOFF : 0);
-      t.c_iflag &= ~(INPCK | ISTRIP | IMAXBEL |
-		     (swHandshake ? 0 : IXON |  IXOFF)
-		     | IXANY | IGNCR | ICRNL | IMAXBEL | INLCR | IGNBRK);
-      t.c_oflag &= ~(OPOST);
-      // be careful, only touch "known" flags
-      t.c_cflag &= ~(CSIZE | CSTOPB | PARENB | PARODD |
-		     (swHandshake ? CRTSCTS : 0 ));
-      t.c_cflag |= CS8 | CREAD | HUPCL | (swHandshake ? 0 : CRTSCTS) | CLOCAL;
-      t.c_lflag &= ~(ECHO | ECHOE | ECHOPRT | ECHOK | ECHOKE | ECHONL |
-		     ECHOCTL | ISIG | IEXTEN | TOSTOP | FLUSHO | ICANON);
-      t.c_lflag |= NOFLSH;
-      t.c_cc[VMIN] = 1;
-      t.c_cc[VTIME] = 0;
-      
-      t.c_cc[VSUSP] = 0;
-      
-      // write back
-      if(tcsetattr (_fd, TCSANOW, &t) < 0)
-	{
-	  close(_fd);
-	  throwModemException(stringPrintf(_("tcsetattr device '%s'"),
-					   device.c_str()));
-	}
-      // the waiting time for writing to the ME/TA is increased with each loop
-      usleep(holdoff[initTries]);
-      
-      // flush all pending input
-      tcflush(_fd, TCIFLUSH);
-      
+
+      // phase 3: reset modem settings and send the init string
+      gettimeofday(&start, NULL);
       try
-	{
-	  // reset modem
-	  putLine("ATZ");
-	  bool foundOK = false;
-	  int readTries = 5;
-	  while (readTries-- > 0)
-	    {
-	      // for the first call getLine() waits only 3 seconds
-	      // because of _timeoutVal = 3
-	      std::string s = getLine();
-	      if (s.find("OK") != std::string::npos ||
-		  s.find("CABLE: GSM") != std::string::npos)
-		{
-		  foundOK = true;
-		  readTries = 0;        // found OK, exit loop
-		}
-	      else if (s.find("ERROR") != std::string::npos)
-		readTries = 0;        // error, exit loop
-	    }
-	  
-	  // set getLine/putLine timeout back to old value
-	  _timeoutVal = saveTimeoutVal;
-	  
-	  if (foundOK)
-	    {
-	      // init modem
-	      readTries = 5;
-	      putLine("AT" + initString);
-	      while (readTries-- > 0)
-		{
-		  std::string s = getLine();
-		  if (s.find("OK") != std::string::npos ||
-		      s.find("CABLE: GSM") != std::string::npos)
-		    return;                 // found OK, return
-		}
-	    }
-	}
+      {
+        // for ATZ getLine() waits only 3 seconds
+        ready = initChat("ATZ", 3000) &&
+          initChat("AT" + initString, _timeoutVal);
+      }
       catch (GsmException &e)
-	{
-	  _timeoutVal = saveTimeoutVal;
-	  if (initTries == 0) {
-	    close(_fd);
-	    throw e;
-	  }
-	}
+      {
+        if (dtrTries == holdoffArraySize)
+          throw;
+        ready = false;
+      }
+      reportPhase(ready ? "modem init succeeded" : "modem init failed",
+                  start);
+      if (ready)
+      {
+        // phase 4: switch to a faster line speed if requested
+        const char *maxBaudRate = getenv("GSMLIB_MAX_BAUDRATE");
+        if (maxBaudRate != NULL && *maxBaudRate != 0)
+        {
+          gettimeofday(&start, NULL);
+          upgradeLineSpeed(baudRateStrToSpeed(maxBaudRate));
+          reportPhase("line speed upgrade", start);
+        }
+        return;
+      }
+    }
+  }
+  catch (GsmException &e)
+  {
+    close(_fd);
+    throw;
+  }
+}
+
+speed_t UnixSerialPort::upgradeLineSpeed(speed_t maxSpeed)
+  throw(GsmException)
+{
+  int current = lineSpeedIndex(_lineSpeed);
+  int max = lineSpeedIndex(maxSpeed);
+  if (current == -1 || max <= current)
+    return _lineSpeed;
+
+  // get the current and the supported baud rates of the ME/TA
+  // the response to +IPR=? has the form "(autodetectable),(fixed only)"
+  std::string baudRate, baudRates;
+  if (! initChat("AT+IPR?", _timeoutVal, &baudRate) ||
+      ! initChat("AT+IPR=?", _timeoutVal, &baudRates))
+    return _lineSpeed;          // +IPR not supported
+  IntSet supported;
+  try
+  {
+    Parser p(baudRate.substr(baudRate.find(':') + 1));
+    baudRate = stringPrintf("%d", p.parseInt());
+    Parser q(baudRates.substr(baudRates.find(':') + 1));
+    supported = q.parseIntSet();
+    if (q.parseComma(true))
+    {
+      IntSet fixed = q.parseIntSet();
+      for (unsigned int i = 0; i < fixed.ranges(); ++i)
+        supported.insert(fixed.range(i)._low, fixed.range(i)._high);
     }
-  // no response after 3 tries
-  close(_fd);
-  throw GsmException(stringPrintf(_("reset modem failed '%s'"),
-                                  device.c_str()), OtherError);
+  }
+  catch (GsmException &e)
+  {
+    return _lineSpeed;          // unknown response format
+  }
+
+  // choose the fastest baud rate supported by both sides
+  int best = max;
+  while (best > current && ! supported.contains(lineSpeeds[best]._baudRate))
+    --best;
+  if (best == current)
+    return _lineSpeed;
+
+  // the ME/TA answers with OK at the old baud rate, then switches
+  speed_t oldSpeed = _lineSpeed;
+  bool oldSwHandshake = _swHandshake;
+  if (! initChat(stringPrintf("AT+IPR=%d", lineSpeeds[best]._baudRate),
+                 _timeoutVal))
+    return _lineSpeed;
+  tcdrain(_fd);
+  usleep(baudRateSwitchDelay);
+  setLineModes(lineSpeeds[best]._speed, false);
+
+  bool ready = false;
+  for (int i = 0; i < probeTries && ! ready; ++i)
+    ready = probe();
+  if (ready)
+  {
+    _savedBaudRate = baudRate;
+    return _lineSpeed;
+  }
+
+  // roll back, this only works if the ME/TA understands us at the new
+  // baud rate at least partially
+  try
+  {
+    putLine("AT+IPR=" + baudRate);
+    tcdrain(_fd);
+  }
+  catch (GsmException &e)
+  {
+  }
+  usleep(baudRateSwitchDelay);
+  setLineModes(oldSpeed, oldSwHandshake);
+  for (int i = 0; i < probeTries && ! ready; ++i)
+    ready = probe();
+  if (! ready)
+    throw GsmException(
+      stringPrintf(_("ME/TA does not answer after switching to %d baud"),
+                   lineSpeeds[best]._baudRate), OtherError);
+  return _lineSpeed;
 }
 
 std::string UnixSerialPort::getLine() throw(GsmException)
 {
-  std::string result;
-  int c;
-  while ((c = readByte()) >= 0)
+  return getLineView().str();
+}
+
+StringView UnixSerialPort::getLineView() throw(GsmException)
+{
+  // find LF, only the newly read data needs to be searched
+  size_t scanned = 0;
+  char *lf;
+  while ((lf = (char*)memchr(&_rxBuffer[0] + _rxStart + scanned, LF,
+                             _rxEnd - _rxStart - scanned)) == NULL)
   {
-    while (c == CR)
-      c = readByte();
-    if (c == LF)
-      break;
-    result += c;
+    scanned = _rxEnd - _rxStart;
+    fillBuffer();
   }
 
+  // remove CRs in place
+  char *line = &_rxBuffer[0] + _rxStart, *end = line;
+  for (char *p = line; p != lf; ++p)
+    if (*p != CR)
+      *end++ = *p;
+  _rxStart = lf + 1 - &_rxBuffer[0];
+  StringView result(line, end - line);
+
 #ifndef NDEBUG
   if (debugLevel() >= 1)
-    std::cerr << "<-- " << result << std::endl;
+  {
+    std::cerr << "<-- ";
+    std::cerr.write(result.data(), result.length());
+    std::cerr << std::endl;
+  }
 #endif
 
   return result;
@@ -336,7 +572,7 @@ void UnixSerialPort::putLine(std::string line, bool carriageReturn)
   if (carriageReturn) line += CR;
   const char *l = line.c_str();
   
-  int timeElapsed = 0;
+  long timeElapsed = 0;
   struct timeval oneSecond;
 
   ssize_t bytesWritten = 0;
@@ -363,7 +599,7 @@ void UnixSerialPort::putLine(std::string line, bool carriageReturn)
 	  break;
 	}
       case 0:
-	++timeElapsed;
+	timeElapsed += 1000;
 	break;
       default:
 	if (errno != EINTR)
@@ -384,7 +620,7 @@ void UnixSerialPort::putLine(std::string line, bool carriageReturn)
     else
     {
       assert(errno == EINTR);
-      ++timeElapsed;
+      timeElapsed += 1000;
     }
   }
   if (timeElapsed >= _timeoutVal)
@@ -396,6 +632,9 @@ void UnixSerialPort::putLine(std::string line, bool carriageReturn)
 
 bool UnixSerialPort::wait(GsmTime timeout) throw(GsmException)
 {
+  if (_rxStart != _rxEnd)
+    return true;
+
   fd_set fds;
   FD_ZERO(&fds);
   FD_SET(_fd, &fds);
@@ -405,50 +644,32 @@ bool UnixSerialPort::wait(GsmTime timeout) throw(GsmException)
 // set timeout for read or write in seconds.
 void UnixSerialPort::setTimeOut(unsigned int timeout)
 {
-  _timeoutVal = timeout;
+  _timeoutVal = timeout * 1000L;
 }
 
 UnixSerialPort::~UnixSerialPort()
 {
   if (_fd != -1)
+  {
+    // switch the ME/TA back to its old baud rate so that the next user
+    // of the port finds it as expected
+    if (_savedBaudRate != "")
+      try
+      {
+        initChat("AT+IPR=" + _savedBaudRate, probeTimeout);
+      }
+      catch (GsmException &e)
+      {
+      }
     close(_fd);
+  }
 }
 
 speed_t gsmlib::baudRateStrToSpeed(std::string baudrate) throw(GsmException)
 {
-  if (baudrate == "300")
-    return B300;
-  else if (baudrate == "600")
-    return B600;
-  else if (baudrate == "1200")
-    return B1200;
-  else if (baudrate == "2400")
-    return B2400;
-  else if (baudrate == "4800")
-    return B4800;
-  else if (baudrate == "9600")
-    return B9600;
-  else if (baudrate == "19200")
-    return B19200;
-  else if (baudrate == "38400")
-    return B38400;
-#ifdef B57600
-  else if (baudrate == "57600")
-    return B57600;
-#endif
-#ifdef B115200
-  else if (baudrate == "115200")
-    return B115200;
-#endif
-#ifdef B230400
-  else if (baudrate == "230400")
-    return B230400;
-#endif
-#ifdef B460800
-  else if (baudrate == "460800")
-    return B460800;
-#endif
-  else
-    throw GsmException(stringPrintf(_("unknown baudrate '%s'"),
-                                    baudrate.c_str()), ParameterError);
+  for (int i = 0; i < lineSpeedsSize; ++i)
+    if (baudrate == stringPrintf("%d", lineSpeeds[i]._baudRate))
+      return lineSpeeds[i]._speed;
+  throw GsmException(stringPrintf(_("unknown baudrate '%s'"),
+                                  baudrate.c_str()), ParameterError);
 }
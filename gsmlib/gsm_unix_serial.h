@@ -19,6 +19,7 @@
 #include <gsmlib/gsm_util.h>
 #include <sys/types.h>
 #include <termios.h>
+#include <vector>
 
 namespace gsmlib
 {
@@ -28,11 +29,37 @@ namespace gsmlib
     int _fd;                    // file descriptor for device
     int _debug;                 // debug level (set by environment variable
                                 // GSM_DEBUG
-    int _oldChar;               // character set by putBack() (-1 == none)
-    long int _timeoutVal;       // timeout for getLine/readByte
+    std::vector<char> _rxBuffer; // data read from device
+    size_t _rxStart, _rxEnd;    // unread data in _rxBuffer
+    long int _timeoutVal;       // timeout for getLine/readByte in msecs
+    speed_t _lineSpeed;         // current line speed
+    bool _swHandshake;          // true if XON/XOFF handshake is used
+    std::string _savedBaudRate; // +IPR setting of the ME/TA before
+                                // upgradeLineSpeed(), empty if unchanged
 
     // throw GsmException include UNIX errno
     void throwModemException(std::string message) throw(GsmException);
+
+    // wait for data and append all available data to _rxBuffer
+    // may move the unread data within _rxBuffer
+    void fillBuffer() throw(GsmException);
+
+    // set line speed and modes of the device
+    void setLineModes(speed_t lineSpeed, bool swHandshake)
+      throw(GsmException);
+
+    // reset modem by toggling DTR, wait holdoff usecs twice
+    void resetDTR(int holdoff) throw(GsmException);
+
+    // send command during initialization and wait at most timeout msecs
+    // for each line of the response
+    // return true if the response is "OK"
+    // if info != NULL, it is set to the last line starting with '+'
+    bool initChat(std::string command, long timeout,
+                  std::string *info = NULL) throw(GsmException);
+
+    // return true if the modem answers a plain AT quickly
+    bool probe();
     
   public:
     // create Port given the UNIX device name
@@ -41,10 +68,22 @@ namespace gsmlib
                    bool swHandshake = false)
       throw(GsmException);
 
+    // switch ME/TA and port to the fastest baud rate up to maxSpeed that
+    // both support (using +IPR), with RTS/CTS handshake
+    // - the new line speed is checked with AT, the old one restored if
+    //   this fails
+    // - the ME/TA is switched back to its old baud rate when the port
+    //   is closed
+    // - the constructor calls this if the environment variable
+    //   GSMLIB_MAX_BAUDRATE is set (eg. to "115200")
+    // return the line speed now in use
+    speed_t upgradeLineSpeed(speed_t maxSpeed) throw(GsmException);
+
     // inherited from Port
     void putBack(unsigned char c);
     int readByte() throw(GsmException);
     std::string getLine() throw(GsmException);
+    StringView getLineView() throw(GsmException);
     void putLine(std::string line,
                          bool carriageReturn = true) throw(GsmException);
     bool wait(GsmTime timeout) throw(GsmException);
@@ -53,7 +92,7 @@ namespace gsmlib
     virtual ~UnixSerialPort();
   };
 
-  // convert baudrate string ("300" .. "460800") to speed_t
+  // convert baudrate string ("300" .. "921600", depending on the system) to speed_t
   extern speed_t baudRateStrToSpeed(std::string baudrate) throw(GsmException);
 };
 
@@ -23,8 +23,10 @@
 #include <sstream>
 #include <ctype.h>
 #include <errno.h>
+#include <algorithm>
 #if !defined(HAVE_CONFIG_H) || defined(HAVE_UNISTD_H)
   #include <unistd.h>
+  #include <fcntl.h>
 #endif
 #if !defined(HAVE_CONFIG_H) || defined(HAVE_MALLOC_H)
   #include <malloc.h>
@@ -42,6 +44,7 @@
 #include <cstdlib>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <fstream>
 
 using namespace gsmlib;
 
@@ -161,10 +164,32 @@ bool gsmlib::hexToBuf(const std::string &hexString, unsigned char *buf)
   return true;
 }
 
+unsigned long gsmlib::crc32(const char *buf, unsigned long length)
+{
+  static unsigned long table[256];
+  static bool tableInitialized = false;
+  if (! tableInitialized)
+  {
+    for (unsigned int n = 0; n < 256; ++n)
+    {
+      unsigned long c = n;
+      for (int k = 0; k < 8; ++k)
+        c = (c & 1) ? (0xedb88320UL ^ (c >> 1)) : (c >> 1);
+      table[n] = c;
+    }
+    tableInitialized = true;
+  }
+
+  unsigned long crc = 0xffffffffUL;
+  for (unsigned long i = 0; i < length; ++i)
+    crc = table[(crc ^ (unsigned char)buf[i]) & 0xff] ^ (crc >> 8);
+  return crc ^ 0xffffffffUL;
+}
+
 std::string gsmlib::intToStr(int i)
 {
   std::ostringstream os;
-  os << i << std::ends;
+  os << i;
   return os.str();
 }
 
@@ -255,6 +280,140 @@ void gsmlib::renameToBackupFile(std::string filename) throw(GsmException)
       OSError, errno);
 }
 
+void gsmlib::makeBackupFile(std::string filename) throw(GsmException)
+{
+  std::string backupFilename = filename + "~";
+  unlink(backupFilename.c_str());
+#if !defined(HAVE_CONFIG_H) || defined(HAVE_UNISTD_H)
+  if (link(filename.c_str(), backupFilename.c_str()) == 0)
+    return;
+#endif
+  // no hard links on this file system, copy the file
+  std::ifstream is(filename.c_str(), std::ios::in | std::ios::binary);
+  std::ofstream os(backupFilename.c_str(), std::ios::out | std::ios::binary);
+  if (is && os)
+    os << is.rdbuf();
+  os.close();
+  if (! is || os.fail())
+  {
+    unlink(backupFilename.c_str());
+    throw GsmException(
+      stringPrintf(_("error copying '%s' to '%s'"),
+                   filename.c_str(), backupFilename.c_str()),
+      OSError, errno);
+  }
+}
+
+void gsmlib::replaceFile(std::string filename, std::string newFilename,
+                         const std::string &data) throw(GsmException)
+{
+#if !defined(HAVE_CONFIG_H) || defined(HAVE_UNISTD_H)
+  int fd = open(newFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1)
+    throw GsmException(stringPrintf(_("error opening file '%s' for writing"),
+                                    newFilename.c_str()), OSError, errno);
+  bool ok = true;
+  const char *p = data.data();
+  size_t len = data.length();
+  while (ok && len > 0)
+  {
+    ssize_t written = write(fd, p, len);
+    if (written != -1)
+    {
+      p += written;
+      len -= written;
+    }
+    else if (errno != EINTR)
+      ok = false;
+  }
+  ok = ok && fsync(fd) == 0;
+  if (close(fd) != 0)
+    ok = false;
+#else
+  std::ofstream os(newFilename.c_str(), std::ios::out | std::ios::binary);
+  if (! os)
+    throw GsmException(stringPrintf(_("error opening file '%s' for writing"),
+                                    newFilename.c_str()), OSError);
+  os.write(data.data(), data.length());
+  os.close();
+  bool ok = ! os.fail();
+#endif
+  if (! ok)
+  {
+    remove(newFilename.c_str());
+    throw GsmException(stringPrintf(_("error writing to file '%s'"),
+                                    newFilename.c_str()), OSError);
+  }
+
+#if defined(HAVE_CONFIG_H) && ! defined(HAVE_UNISTD_H)
+  // rename() does not replace existing files on Win32
+  remove(filename.c_str());
+#endif
+  if (rename(newFilename.c_str(), filename.c_str()) < 0)
+  {
+    int error = errno;
+    remove(newFilename.c_str());
+    throw GsmException(stringPrintf(_("error renaming '%s' to '%s'"),
+                                    newFilename.c_str(), filename.c_str()),
+                       OSError, error);
+  }
+}
+
+std::string gsmlib::escapeString(const std::string &s)
+{
+  std::string result;
+  result.reserve(s.length());
+
+  std::string::size_type start = 0, pos;
+  while ((pos = s.find_first_of("\r\n\\|", start)) != std::string::npos)
+  {
+    result.append(s, start, pos - start);
+    if (s[pos] == CR)
+      result += "\\r";
+    else if (s[pos] == LF)
+      result += "\\n";
+    else
+    {
+      result += '\\';
+      result += s[pos];
+    }
+    start = pos + 1;
+  }
+  result.append(s, start, std::string::npos);
+  return result;
+}
+
+std::string gsmlib::unescapeString(const char *&p, const char *end)
+{
+  std::string result;
+
+  while (p != end)
+  {
+    // copy runs of ordinary characters at once
+    const char *run = p;
+    while (p != end && *p != '|' && *p != '\\' && *p != CR && *p != LF)
+      ++p;
+    result.append(run, p - run);
+
+    if (p == end || *p != '\\' || p + 1 == end ||
+        p[1] == CR || p[1] == LF)
+    {
+      if (p != end && *p == '\\')
+        ++p;                    // drop dangling backslash
+      break;
+    }
+    ++p;
+    if (*p == 'r')
+      result += CR;
+    else if (*p == 'n')
+      result += LF;
+    else
+      result += *p;
+    ++p;
+  }
+  return result;
+}
+
 // NoCopy members
 
 #ifndef NDEBUG
@@ -384,3 +543,85 @@ bool gsmlib::isSet(std::vector<bool> &b, unsigned int bit)
 {
   return b.size() > bit && b[bit];
 }
+
+// IntSet members
+
+void IntSet::assign(const std::vector<IntRange> &v)
+{
+  _size = v.size();
+  if (_size <= INLINE_RANGES)
+  {
+    std::copy(v.begin(), v.end(), _inline);
+    _more.clear();
+  }
+  else
+    _more = v;
+}
+
+void IntSet::insert(int low, int high)
+{
+  if (low > high)
+    std::swap(low, high);
+
+  // common case: append after the last range
+  if (_size == 0 || low > range(_size - 1)._high + 1)
+  {
+    IntRange r;
+    r._low = low;
+    r._high = high;
+    if (_size < INLINE_RANGES)
+      _inline[_size] = r;
+    else
+    {
+      if (_size == INLINE_RANGES)
+        _more.assign(_inline, _inline + INLINE_RANGES);
+      _more.push_back(r);
+    }
+    ++_size;
+    return;
+  }
+
+  // merge with overlapping and adjacent ranges
+  std::vector<IntRange> v;
+  for (unsigned int i = 0; i < _size; ++i)
+    v.push_back(range(i));
+  std::vector<IntRange>::iterator first = v.begin();
+  while (first != v.end() && first->_high + 1 < low)
+    ++first;
+  std::vector<IntRange>::iterator last = first;
+  while (last != v.end() && last->_low <= high + 1)
+  {
+    if (last->_low < low) low = last->_low;
+    if (last->_high > high) high = last->_high;
+    ++last;
+  }
+  IntRange r;
+  r._low = low;
+  r._high = high;
+  first = v.erase(first, last);
+  v.insert(first, r);
+  assign(v);
+}
+
+bool IntSet::contains(int i) const
+{
+  // binary search for the last range with _low <= i
+  unsigned int lo = 0, hi = _size;
+  while (lo < hi)
+  {
+    unsigned int mid = (lo + hi) / 2;
+    if (range(mid)._low <= i)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo > 0 && i <= range(lo - 1)._high;
+}
+
+unsigned int IntSet::count() const
+{
+  unsigned int result = 0;
+  for (unsigned int i = 0; i < _size; ++i)
+    result += range(i)._high - range(i)._low + 1;
+  return result;
+}
@@ -20,6 +20,7 @@
 #include <sys/time.h>
 #endif
 #include <stdio.h>
+#include <string.h>
 
 namespace gsmlib
 {
@@ -50,9 +51,53 @@ namespace gsmlib
   // convert hexString to byte buffer, return false if no hexString
   bool hexToBuf(const std::string &hexString, unsigned char *buf);
 
+  // return CRC-32 checksum (as used by zlib) of byte buffer of length
+  unsigned long crc32(const char *buf, unsigned long length);
+
   // indicate that a value is not set
   const int NOT_SET = -1;
 
+  // reference to characters owned by someone else (eg. a std::string)
+  // the characters must not change or go away while the view is in use
+
+  class StringView
+  {
+  private:
+    const char *_data;
+    unsigned int _length;
+
+  public:
+    StringView() : _data(""), _length(0) {}
+    StringView(const char *data, unsigned int length) :
+      _data(data), _length(length) {}
+    StringView(const char *s) : _data(s), _length(strlen(s)) {}
+    StringView(const std::string &s) : _data(s.data()), _length(s.length()) {}
+
+    const char *data() const {return _data;}
+    unsigned int length() const {return _length;}
+    bool empty() const {return _length == 0;}
+    char operator[](unsigned int i) const {return _data[i];}
+
+    // return view of length characters starting at pos
+    StringView substr(unsigned int pos, unsigned int length) const
+      {return StringView(_data + pos, length);}
+
+    // return true if the view starts with prefix
+    bool startsWith(StringView prefix) const
+      {return prefix._length <= _length &&
+          memcmp(_data, prefix._data, prefix._length) == 0;}
+
+    // return copy of the characters
+    std::string str() const {return std::string(_data, _length);}
+
+    bool operator==(StringView s) const
+      {return s._length == _length && memcmp(_data, s._data, _length) == 0;}
+    bool operator!=(StringView s) const {return ! (*this == s);}
+    bool operator==(const char *s) const
+      {return strlen(s) == _length && memcmp(_data, s, _length) == 0;}
+    bool operator!=(const char *s) const {return ! (*this == s);}
+  };
+
   // An integer range
   struct IntRange
   {
@@ -67,7 +112,55 @@ namespace gsmlib
     IntRange _range;
   };
 
+  // A set of integers, stored as a sorted list of disjoint closed ranges
+  // (eg. (1-500) is stored as one range)
+  // the first few ranges are kept in the object itself, so that typical
+  // sets do not need any memory allocation
+
+  class IntSet
+  {
+  private:
+    enum {INLINE_RANGES = 4};
+
+    unsigned int _size;         // number of ranges
+    IntRange _inline[INLINE_RANGES]; // ranges if _size <= INLINE_RANGES
+    std::vector<IntRange> _more; // ranges if _size > INLINE_RANGES
+
+    // replace ranges by those in v
+    void assign(const std::vector<IntRange> &v);
+
+  public:
+    IntSet() : _size(0) {}
+
+    // add the integers low..high (or high..low)
+    void insert(int low, int high);
+    void insert(int i) {insert(i, i);}
+
+    // return true if i is in the set
+    bool contains(int i) const;
+
+    // return number of ranges and range i
+    unsigned int ranges() const {return _size;}
+    const IntRange &range(unsigned int i) const
+      {return _size <= INLINE_RANGES ? _inline[i] : _more[i];}
+
+    // return true if the set is empty
+    bool empty() const {return _size == 0;}
+
+    // return number of integers in the set
+    unsigned int count() const;
+
+    // return smallest and largest integer in the set (NOT_SET if empty)
+    int min() const {return _size == 0 ? NOT_SET : range(0)._low;}
+    int max() const {return _size == 0 ? NOT_SET : range(_size - 1)._high;}
+  };
+
   // *** general-purpose pointer wrapper with reference counting
+  // the reference count is changed atomically (if supported by the
+  // compiler), so that Refs to the same object can be used by several
+  // threads; the object itself is not protected
+  // single-threaded applications can define GSMLIB_NONATOMIC_REFCOUNT
+  // when compiling gsmlib and the application to use a plain counter
   class RefBase
   {
   private:
@@ -75,8 +168,13 @@ namespace gsmlib
     
   public:
     RefBase() : _refCount(0) {}
+#if defined(__GNUC__) && ! defined(GSMLIB_NONATOMIC_REFCOUNT)
+    int ref() {return __sync_fetch_and_add(&_refCount, 1);}
+    int unref() {return __sync_sub_and_fetch(&_refCount, 1);}
+#else
     int ref() {return _refCount++;}
     int unref() {return --_refCount;}
+#endif
     int refCount() const {return _refCount;}
   };
   
@@ -87,20 +185,32 @@ namespace gsmlib
       T *_rep;
     public:
       T *operator->() const {return _rep;}
-      T &operator()() {return *_rep;}
-      T *getptr() {return _rep;}
+      T &operator()() const {return *_rep;}
+      T *getptr() const {return _rep;}
       bool isnull() const {return _rep == (T*)NULL;}
       Ref() : _rep((T*)NULL) {}
       Ref(T *pp) : _rep(pp) {if (pp != (T*)NULL) pp->ref();}
       Ref(const Ref &r);
       Ref &operator=(const Ref &r);
+#if __cplusplus >= 201103L
+      // take over the object of r without changing the reference count
+      Ref(Ref &&r) : _rep(r._rep) {r._rep = (T*)NULL;}
+      Ref &operator=(Ref &&r);
+#endif
       ~Ref();
       bool operator==(const Ref &r) const
         {
           return _rep == r._rep;
         }
+
+      // exchange objects with r without changing the reference counts
+      // use this to hand a Ref over in C++98 builds
+      void swap(Ref &r) {T *rep = _rep; _rep = r._rep; r._rep = rep;}
     };
 
+  template <class T>
+    inline void swap(Ref<T> &a, Ref<T> &b) {a.swap(b);}
+
   template <class T>
     Ref<T>::Ref(const Ref<T> &r) : _rep(r._rep)
     {
@@ -110,12 +220,26 @@ namespace gsmlib
   template <class T>
     Ref<T> &Ref<T>::operator=(const Ref<T> &r)
     {
+      if (_rep == r._rep) return *this;
       if (r._rep != (T*)NULL) r._rep->ref();
       if (_rep != (T*)NULL && _rep->unref() == 0) delete _rep;
       _rep = r._rep;
       return *this;
     }
 
+#if __cplusplus >= 201103L
+  template <class T>
+    Ref<T> &Ref<T>::operator=(Ref<T> &&r)
+    {
+      if (this == &r) return *this;
+      T *rep = _rep;
+      _rep = r._rep;
+      r._rep = (T*)NULL;
+      if (rep != (T*)NULL && rep->unref() == 0) delete rep;
+      return *this;
+    }
+#endif
+
   template <class T>
     Ref<T>::~Ref()
     {
@@ -131,6 +255,10 @@ namespace gsmlib
   // return true if bit is set in vector<bool>
   bool isSet(std::vector<bool> &b, unsigned int bit);
 
+  // return true if bit is in IntSet
+  inline bool isSet(const IntSet &s, unsigned int bit)
+    {return s.contains(bit);}
+
   // return true if filename refers to a file
   // throws exception if filename is neither file nor device
   bool isFile(std::string filename);
@@ -138,6 +266,25 @@ namespace gsmlib
   // make backup file adequate for this operating system
   void renameToBackupFile(std::string filename) throw(GsmException);
 
+  // like renameToBackupFile(), but filename is left in place
+  // (the backup file is a hard link or a copy)
+  void makeBackupFile(std::string filename) throw(GsmException);
+
+  // replace the contents of filename with data
+  // data is written to newFilename, flushed to disk, and then renamed to
+  // filename, so that filename always has either the old or the new
+  // contents, even after a crash
+  void replaceFile(std::string filename, std::string newFilename,
+                   const std::string &data) throw(GsmException);
+
+  // escape CR, LF, '\\', and '|' in s for line-based files with fields
+  // separated by '|' (CR and LF are written as "\r" and "\n")
+  std::string escapeString(const std::string &s);
+
+  // undo escapeString()
+  // start parsing at p, stop when CR, LF, '|', or end is encountered
+  std::string unescapeString(const char *&p, const char *end);
+
   // Base class for class for which copying is not allow
   // only used for debugging
 
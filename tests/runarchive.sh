@@ -0,0 +1,14 @@
+#!/bin/sh
+
+errorexit() {
+    echo $1
+    exit 1
+}
+
+rm -f archive.sma || errorexit "could not delete archive.sma"
+
+# run the test
+./testarchive > testarchive.log
+
+# check if output differs from what it should be
+diff testarchive.log testarchive-output.txt
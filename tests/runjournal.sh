@@ -0,0 +1,16 @@
+#!/bin/sh
+
+errorexit() {
+    echo $1
+    exit 1
+}
+
+rm -f journal.sms journal.sms~ journal.sms.new ||
+    errorexit "could not delete journal.sms"
+touch journal.sms || errorexit "could not create journal.sms"
+
+# run the test
+./testjournal > testjournal.log
+
+# check if output differs from what it should be
+diff testjournal.log testjournal-output.txt
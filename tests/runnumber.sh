@@ -0,0 +1,12 @@
+#!/bin/sh
+
+errorexit() {
+    echo $1
+    exit 1
+}
+
+# run the test
+./testnumber > testnumber.log
+
+# check if output differs from what it should be
+diff testnumber.log testnumber-output.txt
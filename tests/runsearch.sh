@@ -0,0 +1,16 @@
+#!/bin/sh
+
+errorexit() {
+    echo $1
+    exit 1
+}
+
+rm -f search.sms search.sms~ search.sms.new search.idx search.idx.new ||
+    errorexit "could not delete search.sms"
+touch search.sms || errorexit "could not create search.sms"
+
+# run the test
+./testsearch > testsearch.log
+
+# check if output differs from what it should be
+diff testsearch.log testsearch-output.txt
@@ -0,0 +1,15 @@
+#!/bin/sh
+
+errorexit() {
+    echo $1
+    exit 1
+}
+
+# run the test
+./testshared > testshared.log
+
+# SharedMeTa not available without POSIX threads
+test $? = 77 && exit 77
+
+# check if output differs from what it should be
+diff testshared.log testshared-output.txt
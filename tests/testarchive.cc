@@ -0,0 +1,168 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testarchive.cc
+// *
+// * Purpose: Test SMS archive files
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#include <gsmlib/gsm_sms_archive.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace gsmlib;
+
+static const char *file = "archive.sma";
+
+// two SMS messages with service centre timestamps
+static const char *pdu1 = "079194710167120004038571F1390099406180904480A0D41631067296EF7390383D07CD622E58CD95CB81D6EF39BDEC66BFE7207A794E2FBB4320AFB82C07E56020A8FC7D9687DBED32285C9F83A06F769A9E5EB340D7B49C3E1FA3C3663A0B24E4CBE76516680A7FCBE920725A5E5ED341F0B21C346D4E41E1BA790E4286DDE4BC0BD42CA3E5207258EE1797E5A0BA9B5E9683C86539685997EBEF61341B249BC966";
+static const char *pdu2 = "0791947101671200040B851008050001F23900892171410155409FCEF4184D07D9CBF273793E2FBB432062BA0CC2D2E5E16B398D7687C768FADC5E96B3DFF3BAFB0C62EFEB663AC8FD1EA341E2F41CA4AFB741329A2B2673819C75BABEEC064DD36590BA4CD7D34149B4BC0C3A96EF69B77B8C0EBBC76550DD4D0699C3F8B21B344D974149B4BCEC0651CB69B6DBD53AD6E9F331BA9C7683C26E102C8683BD6A30180C04ABD900";
+
+SMSMessageRef message(int i)
+{
+  switch (i % 4)
+  {
+  case 0:
+    return SMSMessage::decode(pdu1);
+  case 1:
+    return SMSMessage::decode(pdu2);
+  default:
+    ostringstream text, number;
+    text << "archived message " << i;
+    number << "0177" << i % 3;
+    return new SMSSubmitMessage(text.str(), number.str());
+  }
+}
+
+void writeArchive()
+{
+  // write 40 messages into blocks of 1024 bytes
+  SMSArchiveWriter writer(file, 1024);
+  for (int i = 0; i < 40; ++i)
+    writer.add(SMSStoreEntry(message(i)));
+  writer.close();
+}
+
+void openArchive(string title)
+{
+  try
+  {
+    SMSArchive archive(file);
+    cout << title << ": " << archive.blocks() << " blocks" << endl;
+  }
+  catch (GsmException &ge)
+  {
+    cout << title << ": GsmException '" << ge.what() << "'" << endl;
+  }
+}
+
+void printEntries(string title, vector<SMSStoreEntryRef> &entries)
+{
+  cout << title << ": " << entries.size() << " entries";
+  for (vector<SMSStoreEntryRef>::iterator i = entries.begin();
+       i != entries.end(); ++i)
+    cout << " " << (*i)->index();
+  cout << endl;
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    writeArchive();
+
+    // read them back
+    SMSArchive archive(file);
+    cout << "blocks: " << archive.blocks() << endl;
+    vector<SMSStoreEntryRef> entries;
+    for (unsigned int i = 0; i < archive.blocks(); ++i)
+      archive.readBlock(i, entries);
+    cout << "messages: " << entries.size() << endl;
+    int differences = 0;
+    for (unsigned int i = 0; i < entries.size(); ++i)
+      if ((int)entries[i]->index() != (int)i ||
+          entries[i]->message()->encode() != message(i)->encode())
+        ++differences;
+    cout << "differences: " << differences << endl;
+
+    // queries
+    Timestamp timestamp = message(0)->serviceCentreTimestamp();
+    entries.clear();
+    archive.find(timestamp, timestamp, entries);
+    printEntries("timestamp of message 0", entries);
+
+    Address address = message(1)->address();
+    entries.clear();
+    archive.find(address, entries);
+    printEntries("address of message 1", entries);
+
+    address = message(2)->address();
+    entries.clear();
+    archive.find(address, entries);
+    printEntries("address of message 2", entries);
+  }
+  catch (GsmException &ge)
+  {
+    cerr << "GsmException '" << ge.what() << "'" << endl;
+    return 1;
+  }
+
+  // corrupt compressed data is detected by the checksum
+  {
+    SMSArchive archive(file);
+    fstream fs(file, ios::in | ios::out | ios::binary);
+    fs.seekp(archive.block(1)._offset + 10);
+    fs.put('X');
+  }
+  try
+  {
+    SMSArchive archive(file);
+    vector<SMSStoreEntryRef> entries;
+    archive.readBlock(0, entries);
+    cout << "block 0: " << entries.size() << " entries" << endl;
+    archive.readBlock(1, entries);
+  }
+  catch (GsmException &ge)
+  {
+    cout << "GsmException '" << ge.what() << "'" << endl;
+  }
+
+  try
+  {
+    // a corrupt block size is detected by the header checksum
+    writeArchive();
+    {
+      fstream fs(file, ios::in | ios::out | ios::binary);
+      fs.seekp(6);
+      fs.put('\x7f');
+    }
+    openArchive("corrupt block size");
+
+    // so is a block that is cut off
+    writeArchive();
+    openArchive("complete archive");
+    {
+      SMSArchive archive(file);
+      truncate(file, archive.block(archive.blocks() - 1)._offset + 1);
+    }
+    openArchive("truncated archive");
+  }
+  catch (GsmException &ge)
+  {
+    cerr << "GsmException '" << ge.what() << "'" << endl;
+    return 1;
+  }
+
+  // a file that is not an archive is rejected
+  {
+    ofstream os(file, ios::out | ios::binary | ios::trunc);
+    os.write("GSMI\0\1", 6);
+  }
+  openArchive("not an archive");
+  return 0;
+}
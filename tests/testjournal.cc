@@ -0,0 +1,141 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testjournal.cc
+// *
+// * Purpose: Test the journal format of SortedSMSStore files
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#include <gsmlib/gsm_sorted_sms_store.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace gsmlib;
+
+static const char *file = "journal.sms";
+
+long fileSize(string filename)
+{
+  struct stat statBuf;
+  if (stat(filename.c_str(), &statBuf) == -1)
+    return -1;
+  return statBuf.st_size;
+}
+
+void insertMessages(SortedSMSStore &sms, int first, int count)
+{
+  for (int i = first; i < first + count; ++i)
+  {
+    ostringstream text, number;
+    text << "message " << i;
+    number << "0177" << i;
+    SMSMessageRef smsMessage =
+      new SMSSubmitMessage(text.str(), number.str());
+    sms.insert(SMSStoreEntry(smsMessage));
+  }
+}
+
+void printEntries(string title)
+{
+  SortedSMSStore sms((string)file);
+  sms.setSortOrder(ByIndex);
+  cout << title << ": " << sms.size() << " entries" << endl;
+  if (sms.size() > 10)
+    return;
+  for (SortedSMSStore::iterator i = sms.begin(); i != sms.end(); ++i)
+    cout << "Entry#" << i->index() << ": "
+         << i->message()->userData() << endl;
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    // every change is appended to the file
+    {
+      SortedSMSStore sms((string)file);
+      insertMessages(sms, 0, 3);
+    }
+    printEntries("after insert");
+
+    {
+      SortedSMSStore sms((string)file);
+      sms.erase(1);
+    }
+    printEntries("after erase");
+
+    // the remainder of an interrupted append is ignored
+    {
+      ofstream os(file, ios::out | ios::app | ios::binary);
+      os.write("\0\0\x30\0\0\0\x05\x01", 8);
+    }
+    printEntries("after interrupted append");
+
+    // and overwritten by the next append
+    {
+      SortedSMSStore sms((string)file);
+      insertMessages(sms, 3, 1);
+    }
+    printEntries("after append");
+
+    // sync() compacts a journal consisting mostly of dead records
+    {
+      SortedSMSStore sms((string)file);
+      insertMessages(sms, 4, 100);
+    }
+    long size = fileSize(file);
+    {
+      SortedSMSStore sms((string)file);
+      sms.setSortOrder(ByIndex);
+      while (sms.size() > 5)
+        sms.erase(sms.begin());
+      sms.sync();
+    }
+    printEntries("after compaction");
+    cout << "file compacted: " << (fileSize(file) < size / 10 ? "yes" : "no")
+         << endl;
+    cout << "new file left: "
+         << (fileSize((string)file + ".new") == -1 ? "no" : "yes") << endl;
+    cout << "backup file: "
+         << (fileSize((string)file + "~") > size ? "yes" : "no") << endl;
+
+    // clear() leaves only the version number
+    {
+      SortedSMSStore sms((string)file);
+      sms.clear();
+      cout << "file size after clear: " << fileSize(file) << endl;
+    }
+    printEntries("after clear");
+
+    // a record with a wrong checksum is an error
+    {
+      SortedSMSStore sms((string)file);
+      insertMessages(sms, 104, 2);
+    }
+    {
+      fstream fs(file, ios::in | ios::out | ios::binary);
+      fs.seekp(12);
+      fs.put('X');
+    }
+    try
+    {
+      printEntries("after corruption");
+    }
+    catch (GsmException &ge)
+    {
+      cout << "GsmException '" << ge.what() << "'" << endl;
+    }
+  }
+  catch (GsmException &ge)
+  {
+    cerr << "GsmException '" << ge.what() << "'" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,101 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testnumber.cc
+// *
+// * Purpose: Test the lookup of telephone numbers in NumberIndex
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#include <gsmlib/gsm_number_index.h>
+#include <gsmlib/gsm_sorted_phonebook.h>
+#include <iostream>
+
+using namespace std;
+using namespace gsmlib;
+
+void lookup(NumberIndex &index, string telephone)
+{
+  string text;
+  cout << "'" << telephone << "': ";
+  if (index.find(telephone, text))
+    cout << text << endl;
+  else
+    cout << "not found" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    NumberIndex index("49");
+
+    // numbers are normalized to international format
+    cout << "normalized: " << index.normalize("+49 (171) 123-4567") << " "
+         << index.normalize("0049 171 1234567") << " "
+         << index.normalize("0171/1234567") << " "
+         << index.normalize("+44 20 7946 0000") << endl;
+    cout << "not folded: " << NumberIndex().normalize("0171 1234567") << endl;
+
+    index.add("+49 171 1234567", "Anna");
+    index.add("0171 1234567", "Anna (duplicate)");
+    index.add("0049 30 123450", "Office");
+    index.add("110", "Police");
+    index.add("+44 20 7946 0000", "London");
+    cout << "entries: " << index.size() << endl;
+
+    // the same number in different formats
+    lookup(index, "01711234567");
+    lookup(index, "+491711234567");
+    lookup(index, "00491711234567");
+
+    // suffix matches of at least 7 digits
+    lookup(index, "1234567");
+    lookup(index, "+33 171 1234567");
+    lookup(index, "234567");
+    lookup(index, "02079460000");
+
+    // but only if the suffix belongs to a single contact
+    index.add("+43 664 1234567", "Bernd");
+    index.add("+49 89 7654321", "Carl");
+    index.add("+41 44 7654321", "Carl");
+    lookup(index, "+1 555 1234567");
+    lookup(index, "1234567");
+    lookup(index, "+33 171 1234567");
+    lookup(index, "+43 664 1234567");
+    lookup(index, "+1 555 7654321");
+
+    // the main number of a PABX matches its extensions
+    lookup(index, "030 123450 12");
+    lookup(index, "+49 30 1234");
+
+    // short numbers only match exactly
+    lookup(index, "110");
+    lookup(index, "0110");
+    lookup(index, "1100");
+
+    // malformed numbers
+    lookup(index, "");
+    lookup(index, "+");
+    lookup(index, "abc");
+    lookup(index, "00");
+
+    // entries of a phonebook file
+    SortedPhonebook pb((string)"spb.pb", false);
+    index.add(pb);
+    cout << "entries: " << index.size() << endl;
+    lookup(index, "793045");
+    lookup(index, "13333345");
+
+    index.clear();
+    cout << "entries: " << index.size() << endl;
+    lookup(index, "01711234567");
+  }
+  catch (GsmException &ge)
+  {
+    cerr << "GsmException '" << ge.what() << "'" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -42,6 +42,18 @@ void printIntRange(IntRange ir)
   cout << "(" << ir._low << "-" << ir._high << ")";
 }
 
+void printIntSet(const IntSet &is)
+{
+  cout << "(";
+  for (unsigned int i = 0; i < is.ranges(); ++i)
+  {
+    if (i > 0) cout << ",";
+    printIntRange(is.range(i));
+  }
+  cout << ") count " << is.count() << " min " << is.min()
+       << " max " << is.max();
+}
+
 void printStringList(vector<string> vs)
 {
   bool first = true;
@@ -160,6 +172,56 @@ int main(int argc, char *argv[])
            << shortName << "\","
            << numericName << ")" << endl << endl;
     }
+    {
+      cout << "Test 7" << endl;
+      Parser p("(1-3,7,12-10),5");
+
+      IntSet is = p.parseIntSet();
+      p.parseComma();
+      IntSet is2 = p.parseIntSet();
+
+      printIntSet(is);
+      cout << endl;
+      printIntSet(is2);
+      cout << endl;
+      for (int i = 0; i <= 13; ++i)
+        if (is.contains(i)) cout << i << " ";
+      cout << endl << endl;
+    }
+    {
+      cout << "Test 8" << endl;
+      Parser p("(5,1-3,4,10-12,2-11),(1,3,5,7,9,11,13),(1,3,5,7,9,11,2-10)");
+
+      IntSet is = p.parseIntSet();
+      p.parseComma();
+      IntSet is2 = p.parseIntSet();
+      p.parseComma();
+      IntSet is3 = p.parseIntSet();
+
+      printIntSet(is);
+      cout << endl;
+      printIntSet(is2);
+      cout << endl;
+      printIntSet(is3);
+      cout << endl << endl;
+    }
+    {
+      cout << "Test 9" << endl;
+      Parser p("(),,7");
+
+      IntSet is = p.parseIntSet();
+      p.parseComma();
+      IntSet is2 = p.parseIntSet(true);
+      p.parseComma();
+      vector<bool> vb = p.parseIntList();
+
+      printIntSet(is);
+      cout << " " << is.empty() << " " << is.contains(0) << endl;
+      printIntSet(is2);
+      cout << " " << is2.empty() << endl;
+      printIntList(vb);
+      cout << endl << endl;
+    }
   }
   catch (GsmException &p)
   {
@@ -196,5 +258,23 @@ int main(int argc, char *argv[])
   {
     cout << "Error 3: " << p.what() << endl << endl;
   }
+  try
+  {
+    Parser p("(1,2-");
+    p.parseIntSet();
+  }
+  catch (GsmException &p)
+  {
+    cout << "Error 4: " << p.what() << endl << endl;
+  }
+  try
+  {
+    Parser p("(1;2)");
+    p.parseIntSet();
+  }
+  catch (GsmException &p)
+  {
+    cout << "Error 5: " << p.what() << endl << endl;
+  }
 
 }
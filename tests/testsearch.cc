@@ -0,0 +1,144 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testsearch.cc
+// *
+// * Purpose: Test the full-text index of SMS store files
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#include <gsmlib/gsm_sorted_sms_store.h>
+#include <gsmlib/gsm_sms_search_index.h>
+#include <iostream>
+#include <fstream>
+
+using namespace std;
+using namespace gsmlib;
+
+static const char *storeFile = "search.sms";
+static const char *indexFile = "search.idx";
+
+// message texts (Latin-1)
+static const char *texts[] =
+{
+  "Hello World",
+  "Gr\xfc\xdf" "e aus M\xfcnchen",
+  "hello again, world!",
+  "Meeting at 10:30",
+  "GR\xdc\xdf" "E zur\xfc" "ck",
+  NULL
+};
+
+void query(SMSSearchIndex &index, SortedSMSStore &store, string text)
+{
+  vector<SortedSMSStore::iterator> result;
+  index.find(store, text, result);
+  cout << "'" << text << "':";
+  for (vector<SortedSMSStore::iterator>::iterator i = result.begin();
+       i != result.end(); ++i)
+    cout << " " << (*i)->index();
+  cout << endl;
+}
+
+void queries(SMSSearchIndex &index, SortedSMSStore &store, string title)
+{
+  cout << title << ":" << endl;
+  query(index, store, "hello");
+  query(index, store, "WORLD hello");
+  query(index, store, "hello moon");
+  // UTF-8 query for Latin-1 message text
+  query(index, store, "gr\xc3\xbc\xc3\x9f" "e");
+  query(index, store, "10");
+
+  vector<SortedSMSStore::iterator> result;
+  index.find(store, Address("+491771"), result);
+  cout << "address +491771:";
+  for (vector<SortedSMSStore::iterator>::iterator i = result.begin();
+       i != result.end(); ++i)
+    cout << " " << (*i)->index();
+  cout << endl;
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    // messages inserted into the store are added to the index
+    {
+      SortedSMSStore store((string)storeFile);
+      SMSSearchIndexRef index = new SMSSearchIndex(indexFile);
+      store.setSearchIndex(index);
+      for (int i = 0; texts[i] != NULL; ++i)
+      {
+        SMSMessageRef message =
+          new SMSSubmitMessage(texts[i], i % 2 ? "+491771" : "+491772");
+        store.insert(SMSStoreEntry(message));
+      }
+      queries(index(), store, "after insert");
+    }
+
+    // the appended postings are read back
+    {
+      SortedSMSStore store((string)storeFile);
+      SMSSearchIndexRef index = new SMSSearchIndex(indexFile);
+      store.setSearchIndex(index);
+      queries(index(), store, "after reopening");
+
+      // and moved into the sorted part
+      index->merge();
+      queries(index(), store, "after merge");
+
+      // erased messages are skipped
+      store.erase(2);
+      queries(index(), store, "after erase");
+    }
+
+    // the remainder of an interrupted append is dropped
+    {
+      ofstream os(indexFile, ios::out | ios::app | ios::binary);
+      os.write("\x05hel", 4);
+    }
+    {
+      SortedSMSStore store((string)storeFile);
+      SMSSearchIndexRef index = new SMSSearchIndex(indexFile);
+      store.setSearchIndex(index);
+      queries(index(), store, "after interrupted append");
+    }
+  }
+  catch (GsmException &ge)
+  {
+    cerr << "GsmException '" << ge.what() << "'" << endl;
+    return 1;
+  }
+
+  // the sorted part must not extend beyond the end of the file
+  {
+    fstream fs(indexFile, ios::in | ios::out | ios::binary);
+    fs.seekp(10);
+    fs.write("\x7f\0\0\0", 4);
+  }
+  try
+  {
+    SMSSearchIndex index(indexFile);
+  }
+  catch (GsmException &ge)
+  {
+    cout << "GsmException '" << ge.what() << "'" << endl;
+  }
+
+  // a file that is not an index is rejected
+  {
+    ofstream os(indexFile, ios::out | ios::binary | ios::trunc);
+    os.write("GSMA\0\1\0\0\0\0\0\0\0\0\0\0\0\0", 18);
+  }
+  try
+  {
+    SMSSearchIndex index(indexFile);
+  }
+  catch (GsmException &ge)
+  {
+    cout << "GsmException '" << ge.what() << "'" << endl;
+  }
+  return 0;
+}
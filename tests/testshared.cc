@@ -0,0 +1,295 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testshared.cc
+// *
+// * Purpose: Test the scheduling of transactions by SharedMeTa
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#if !defined(HAVE_CONFIG_H) || defined(HAVE_LIBPTHREAD)
+#include <gsmlib/gsm_shared_me_ta.h>
+#include <gsmlib/gsm_port.h>
+#include <iostream>
+#include <pthread.h>
+
+using namespace std;
+using namespace gsmlib;
+
+// port that answers AT commands from a script instead of a device
+
+class FakePort : public Port
+{
+private:
+  string _input;                // pending response of the "ME"
+  pthread_mutex_t _mtx;         // protects _log
+  vector<string> _log;          // commands and PDUs sent to the "ME"
+  unsigned int _pdus;           // number of PDUs received
+  unsigned int _failingPdu;     // PDU to reject (1..) or 0
+
+public:
+  // called when a PDU arrives (before it is answered)
+  void (*_pduHook)(unsigned int pdu);
+
+  FakePort() : _pdus(0), _failingPdu(0), _pduHook(NULL)
+    {pthread_mutex_init(&_mtx, NULL);}
+
+  // reject the n-th PDU from now on with an error
+  void failPdu(unsigned int n) {_failingPdu = _pdus + n;}
+
+  // return and clear log
+  vector<string> log();
+
+  string getLine() throw(GsmException);
+  void putLine(string line, bool carriageReturn = true) throw(GsmException);
+  bool wait(GsmTime timeout) throw(GsmException) {return ! _input.empty();}
+  void putBack(unsigned char c) {_input.insert(_input.begin(), c);}
+  int readByte() throw(GsmException);
+  void setTimeOut(unsigned int timeout) {}
+
+  ~FakePort() {pthread_mutex_destroy(&_mtx);}
+};
+
+vector<string> FakePort::log()
+{
+  pthread_mutex_lock(&_mtx);
+  vector<string> result;
+  result.swap(_log);
+  pthread_mutex_unlock(&_mtx);
+  return result;
+}
+
+string FakePort::getLine() throw(GsmException)
+{
+  string result;
+  int c;
+  do
+  {
+    c = readByte();
+    if (c != '\r')
+      result += (char)c;
+  }
+  while (c != '\n');
+  return result;
+}
+
+int FakePort::readByte() throw(GsmException)
+{
+  if (_input.empty())
+    throw GsmException("timeout when reading from fake port", OtherError);
+  int result = (unsigned char)_input[0];
+  _input.erase(0, 1);
+  return result;
+}
+
+void FakePort::putLine(string line, bool carriageReturn)
+  throw(GsmException)
+{
+  if (! carriageReturn && line.length() > 0 &&
+      line[line.length() - 1] == '\032')
+  {
+    // PDU of AT+CMGS
+    ++_pdus;
+    pthread_mutex_lock(&_mtx);
+    _log.push_back("<PDU>");
+    pthread_mutex_unlock(&_mtx);
+    if (_pduHook != NULL)
+      _pduHook(_pdus);
+    if (_pdus == _failingPdu)
+      _input += "\r\n+CMS ERROR: 500\r\n";
+    else
+      _input += "\r\n+CMGS: " + intToStr(_pdus) + "\r\n\r\nOK\r\n";
+    return;
+  }
+
+  pthread_mutex_lock(&_mtx);
+  _log.push_back(line);
+  pthread_mutex_unlock(&_mtx);
+  if (line == "AT+CSMS?")
+    _input += "\r\n+CSMS: 0,1,1,1\r\n\r\nOK\r\n";
+  else if (line == "AT+CSQ")
+    _input += "\r\n+CSQ: 15,99\r\n\r\nOK\r\n";
+  else if (line.substr(0, 8) == "AT+CMGS=")
+    _input += "\r\n> ";
+  else if (line == "AT+CFUN=9")
+    _input += "\r\n+CME ERROR: 3\r\n";
+  else
+    _input += "\r\nOK\r\n";
+}
+
+// transaction that blocks the I/O thread until it is released
+
+class BlockingTransaction : public Transaction
+{
+private:
+  pthread_mutex_t _mtx;
+  pthread_cond_t _cond;
+  bool _started, _released;
+
+protected:
+  bool run(MeTa &meTa) throw(GsmException);
+
+public:
+  BlockingTransaction();
+
+  // wait until the I/O thread executes the transaction
+  void waitStarted();
+
+  // let the transaction finish
+  void release();
+
+  ~BlockingTransaction();
+};
+
+BlockingTransaction::BlockingTransaction() : _started(false), _released(false)
+{
+  pthread_mutex_init(&_mtx, NULL);
+  pthread_cond_init(&_cond, NULL);
+}
+
+bool BlockingTransaction::run(MeTa &meTa) throw(GsmException)
+{
+  pthread_mutex_lock(&_mtx);
+  _started = true;
+  pthread_cond_broadcast(&_cond);
+  while (! _released)
+    pthread_cond_wait(&_cond, &_mtx);
+  pthread_mutex_unlock(&_mtx);
+  return false;
+}
+
+void BlockingTransaction::waitStarted()
+{
+  pthread_mutex_lock(&_mtx);
+  while (! _started)
+    pthread_cond_wait(&_cond, &_mtx);
+  pthread_mutex_unlock(&_mtx);
+}
+
+void BlockingTransaction::release()
+{
+  pthread_mutex_lock(&_mtx);
+  _released = true;
+  pthread_cond_broadcast(&_cond);
+  pthread_mutex_unlock(&_mtx);
+}
+
+BlockingTransaction::~BlockingTransaction()
+{
+  pthread_cond_destroy(&_cond);
+  pthread_mutex_destroy(&_mtx);
+}
+
+// the interactive transaction submitted while a batch is running
+static SharedMeTa *sharedMeTa = NULL;
+static ChatTransactionRef interrupt;
+
+static void submitInterrupt(unsigned int pdu)
+{
+  if (interrupt.isnull())
+    interrupt = sharedMeTa->chat("+CSQ", "+CSQ:");
+}
+
+void printLog(Ref<FakePort> port)
+{
+  vector<string> log = port->log();
+  for (vector<string>::iterator i = log.begin(); i != log.end(); ++i)
+    cout << "  " << *i << endl;
+}
+
+vector<Ref<SMSSubmitMessage> > makeBatch(unsigned int n)
+{
+  vector<Ref<SMSSubmitMessage> > result;
+  for (unsigned int i = 1; i <= n; ++i)
+    result.push_back(new SMSSubmitMessage("message " + intToStr(i),
+                                          "+491711234567"));
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    Ref<FakePort> port = new FakePort();
+    SharedMeTaRef shared = new SharedMeTa(port.getptr());
+    sharedMeTa = shared.getptr();
+    port->log();                // forget initialization
+
+    // interactive transactions are executed before bulk transactions,
+    // each class in submission order
+    cout << "priority order:" << endl;
+    Ref<BlockingTransaction> block = new BlockingTransaction();
+    shared->submit(block.getptr());
+    block->waitStarted();
+    ChatTransactionRef b1 = shared->chat("+CGMI", "", false, false,
+                                         BulkPriority);
+    ChatTransactionRef b2 = shared->chat("+CGMM", "", false, false,
+                                         BulkPriority);
+    ChatTransactionRef i1 = shared->chat("+CREG=0");
+    ChatTransactionRef i2 = shared->chat("+CLIP=0");
+    block->release();
+    b2->wait();
+    printLog(port);
+
+    // an interactive transaction is executed between two SMSs of a batch
+    cout << "batch with interactive transaction:" << endl;
+    port->_pduHook = submitInterrupt;
+    SMSBatchTransactionRef batch = new SMSBatchTransaction(makeBatch(3));
+    shared->submit(batch.getptr());
+    cout << "  sent: " << batch->sent() << endl;
+    cout << "  interrupt result: " << interrupt->result() << endl;
+    port->_pduHook = NULL;
+    printLog(port);
+
+    // errors of the I/O thread are thrown by wait()
+    cout << "errors:" << endl;
+    try
+    {
+      shared->chat("+CFUN=9")->wait();
+      cout << "  no exception" << endl;
+    }
+    catch (GsmException &ge)
+    {
+      cout << "  GsmException '" << ge.what() << "'" << endl;
+    }
+
+    port->failPdu(2);
+    batch = new SMSBatchTransaction(makeBatch(3));
+    shared->submit(batch.getptr());
+    cout << "  sent: " << batch->sent() << endl;
+    try
+    {
+      batch->wait();
+      cout << "  no exception" << endl;
+    }
+    catch (GsmException &ge)
+    {
+      cout << "  GsmException '" << ge.what() << "'" << endl;
+    }
+    printLog(port);
+
+    // the ME/TA is still usable after the errors
+    cout << "after errors: " << shared->chat("+CSQ", "+CSQ:")->result()
+         << endl;
+  }
+  catch (GsmException &ge)
+  {
+    cerr << "GsmException '" << ge.what() << "'" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+#else
+
+int main(int argc, char *argv[])
+{
+  // SharedMeTa needs POSIX threads, skip the test
+  return 77;
+}
+
+#endif // HAVE_LIBPTHREAD
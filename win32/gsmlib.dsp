@@ -145,6 +145,22 @@ SOURCE=..\gsmlib\gsm_util.cc
 # End Source File
 # Begin Source File
 
+SOURCE=..\gsmlib\gsm_me_ta_profile.cc
+# End Source File
+# Begin Source File
+
+SOURCE=..\gsmlib\gsm_number_index.cc
+# End Source File
+# Begin Source File
+
+SOURCE=..\gsmlib\gsm_sms_search_index.cc
+# End Source File
+# Begin Source File
+
+SOURCE=..\gsmlib\gsm_sms_archive.cc
+# End Source File
+# Begin Source File
+
 SOURCE=..\gsmlib\gsm_win32_serial.cc
 # End Source File
 # End Group
@@ -225,6 +241,22 @@ SOURCE=..\gsmlib\gsm_util.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\gsmlib\gsm_me_ta_profile.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\gsmlib\gsm_number_index.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\gsmlib\gsm_sms_search_index.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\gsmlib\gsm_sms_archive.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\gsmlib\gsm_win32_serial.h
 # End Source File
 # End Group